@@ -968,9 +968,6 @@ extern "C"
 	void IXAsmFiller(IXVertex *Verts, dword numVerts, void *Texture, void *Page, dword logWidth, dword logHeight);
 }
 
-std::mutex mut;
-std::condition_variable cv;
-std::atomic<int> counter;
 
 
 static void drawPoly(float DT)
@@ -1069,8 +1066,8 @@ static void drawPoly(float DT)
 		viewportCalcFlags(vp, &V[i]);
 	}
 
-	counter = 0;
-	ThreadPool::instance().enqueue([&F, &vp, V = &V[0]]() {
+	JobGroup group;
+	ThreadPool::instance().run(group, [&F, &vp, V = &V[0]]() {
 		F.A = &V[0];
 		F.B = &V[1];
 		F.C = &V[2];
@@ -1080,16 +1077,9 @@ static void drawPoly(float DT)
 		F.B = &V[2];
 		F.C = &V[3];
 		_2DClipper::getInstance()->clip(vp, F);
-
-		std::unique_lock<std::mutex> lock(mut);
-		++counter;
-		cv.notify_one();
 	});
 
-	{
-		std::unique_lock<std::mutex> lock(mut);
-		cv.wait(lock, [] {return counter == 1; });
-	}
+	ThreadPool::instance().wait(group);
 
 	/*int32_t my=0;
 	float minY = V[0].PY;
@@ -1137,17 +1127,11 @@ static void drawPoly(float DT)
 		fistp dword ptr [ifl]
 	}
 	F.Txtr->ZBufferWrite = 0;
-	counter = 0;
-	ThreadPool::instance().enqueue([&F, VP=&VP[0]]() {
+	JobGroup group;
+	ThreadPool::instance().run(group, [&F, VP=&VP[0]]() {
 		IX_Prefiller_TGZSAM(&F, VP, 4, 0);
-		std::unique_lock<std::mutex> lock(mut);
-		++counter;
-		cv.notify_one();
 	});
-	{
-		std::unique_lock<std::mutex> lock(mut);
-		cv.wait(lock, [] {return counter == 1; });
-	}*/
+	ThreadPool::instance().wait(group);*/
 
 	//	VPage -= 800;
 	//	IX_Prefiller_TGZ(&F, VP, 4);
@@ -1453,8 +1437,8 @@ static void drawPolyOtherBarry(int32_t seed)
 		viewportCalcFlags(vp, &V[i]);
 	}
 
-	counter = 0;
-	ThreadPool::instance().enqueue([&F, &vp, V = &V[0], numQuads]() {
+	JobGroup group;
+	ThreadPool::instance().run(group, [&F, &vp, V = &V[0], numQuads]() {
 		for (int q = 0; q < numQuads; ++q) {
 			Vertex* Q = const_cast<Vertex*>(V) + q * 4;
 			F.A = &Q[0]; F.B = &Q[1]; F.C = &Q[2];
@@ -1462,16 +1446,9 @@ static void drawPolyOtherBarry(int32_t seed)
 			F.A = &Q[0]; F.B = &Q[2]; F.C = &Q[3];
 			_2DClipper::getInstance()->clip(vp, F);
 		}
-
-		std::unique_lock<std::mutex> lock(mut);
-		++counter;
-		cv.notify_one();
 	});
 
-	{
-		std::unique_lock<std::mutex> lock(mut);
-		cv.wait(lock, [] { return counter == 1; });
-	}
+	ThreadPool::instance().wait(group);
 }
 
 void FillerTestSnapshotInit(int /*xres*/, int /*yres*/)
@@ -6,6 +6,7 @@
 #include "VESA/Vesa.h"
 
 #include <algorithm>
+#include <atomic>
 #include <memory>
 
 void Cross_Fade(byte *U1,byte *U2,byte *Target,int32_t Perc)
@@ -233,6 +234,20 @@ struct GlatoScene : SceneDriver {
 	float Code_RS = 0.0f;
 	float Gfx_RS = 0.0f;
 
+	// Per-frame parameters read by the band jobs.
+	float ST = 0.0f;
+	float CSinR1 = 0.0f, CCosR1 = 0.0f;
+	float GSinR1 = 0.0f, GCosR1 = 0.0f;
+	int Code = 1, Gfx = 0, Sfx = 0;
+
+	// The grid is cast and shaded in bands of GLATO_BAND_ROWS cell rows.
+	// The cell row on a band edge needs grid rows from both neighbours;
+	// Seams[b] counts arrivals of bands b and b+1, the second one shades it.
+	static constexpr int32_t GLATO_BAND_ROWS = 4;
+	int32_t cellRows = 0;
+	int32_t numBands = 0;
+	std::unique_ptr<std::atomic<int>[]> Seams;
+
 	dword TTrd = 0;
 	int32_t timerStack[20] = {};
 	int32_t timerIndex = 0;
@@ -253,25 +268,173 @@ struct GlatoScene : SceneDriver {
 
 		TTrd = Timer;
 
+		cellRows = yres / 8;
+		numBands = (cellRows + GLATO_BAND_ROWS - 1) / GLATO_BAND_ROWS;
+		Seams = std::make_unique<std::atomic<int>[]>(std::max(numBands, 1));
+
 		// clear the screen once (only yres % 8 last lines are really needed)
 		memset(FinalPage, 0, PageSize);
 	}
 
+	// Rotates the screen-space grid coordinates (X,Y) into a Code/Gfx/Sfx
+	// texture grid point, 8 at a time. Same math as the old scalar loop.
+	static inline void Twirl_UV(Vec8f X, Vec8f Y, float UScale, float VScale, float Sin1, float Cos1, Vec8f Sin2, Vec8f Cos2, Vec8f PostScale, Vec8i &U, Vec8i &V)
+	{
+		Vec8f u = X * UScale;
+		Vec8f v = Y * VScale;
+		Vec8f u1 = (u * Sin1 + v * Cos1) * PostScale;
+		Vec8f v1 = (u * Cos1 - v * Sin1) * PostScale;
+		Vec8f u2 = u1 * Sin2 + v1 * Cos2;
+		Vec8f v2 = u1 * Cos2 - v1 * Sin2;
+		U = min(max(truncatei(u2 + 32767.0f), 0), 65535);
+		V = min(max(truncatei(v2 + 32767.0f), 0), 65535);
+	}
+
+	// Casts grid rows [g0, g1): one ray per grid point, 8 rays per vector op,
+	// against the y=+-1 plane pair.
+	void Cast_Rows(int32_t g0, int32_t g1)
+	{
+		const int32_t gridCols = (xres >> 3) + 1;
+		const auto &M = CamMat.Data;
+		const Vec8i lane(0, 1, 2, 3, 4, 5, 6, 7);
+		const float Dz = 256.0 * XResFactor;
+		const float phase = (float)(ST * 0.1f) / 28.65f;
+		const float codeU = 204.8f * rXResFactor * -(Code_RS * 5);
+		const float codeV = 327.68f * rYResFactor * -(Code_RS * 5);
+		const float gfxU = 204.8f * rXResFactor * (Gfx_RS * 20.0f);
+		const float gfxV = 327.68f * rYResFactor * (Gfx_RS * 20.0f);
+
+		alignas(32) float pu[8], pv[8];
+		alignas(32) int32_t pr[8], pg[8], pb[8], tu[8], tv[8];
+
+		for (int32_t gy = g0; gy < g1; gy++)
+		{
+			const float Y = float(gy * 8 - (yres >> 1));
+			for (int32_t gx = 0; gx < gridCols; gx += 8)
+			{
+				const int32_t n = std::min(8, gridCols - gx);
+				const int32_t j = gy * gridCols + gx;
+				const Vec8f X = to_float((lane + gx) * 8 - (xres >> 1));
+
+				Vec8f Dx = M[0][0] * X + M[0][1] * Y + M[0][2] * Dz;
+				Vec8f Dy = M[1][0] * X + M[1][1] * Y + M[1][2] * Dz;
+				Vec8f Dzr = M[2][0] * X + M[2][1] * Y + M[2][2] * Dz;
+				Vec8f inv = approx_rsqrt(Dx * Dx + Dy * Dy + Dzr * Dzr);
+				Dx *= inv; Dy *= inv; Dzr *= inv;
+
+				Vec8fb down = Dy <= 0.0f;
+				Vec8f t = select(down,
+					select(Dy == 0.0f, Vec8f(0.0f), (-1.0f - CameraPos.y) / Dy),
+					(1.0f - CameraPos.y) / Dy);
+				Vec8f Ix = CameraPos.x + Dx * t;
+				Vec8f Iy = CameraPos.y + Dy * t;
+				Vec8f Iz = CameraPos.z + Dzr * t;
+
+				Vec8i cu = truncatei((Ix + phase) * TRIG_FACTOR) & TRIG_MASK;
+				Vec8i cv = truncatei((Iz + phase) * TRIG_FACTOR) & TRIG_MASK;
+				Vec8f u = (Ix + lookup<TRIG_ACC>(cu, CosTable) * 0.5f) * 0.5f;
+				Vec8f v = (Iz + lookup<TRIG_ACC>(cv, SinTable) * 0.5f) * 0.5f;
+
+				Ix -= CameraPos.x; Iy -= CameraPos.y; Iz -= CameraPos.z;
+				Vec8f dp = Ix * Ix + Iy * Iy + Iz * Iz;
+				Vec8f r = select(dp == 0.0f, Vec8f(0.0f), dp * approx_rsqrt(dp)) * 32.f;
+				r = select(down, 255.0f - min(r, 253.0f), max(min(255.0f - r, 253.0f), 2.0f));
+				Vec8f b = min(max(r * 0.7f, 1.0f), 254.0f);
+				Vec8f g = min(max(r * 0.8f, 1.0f), 254.0f);
+
+				(u * 256.0f).store(pu);
+				(v * 256.0f).store(pv);
+				truncatei(r * 63.0f).store(pr);
+				truncatei(g * 63.0f).store(pg);
+				truncatei(b * 63.0f).store(pb);
+				for (int32_t k = 0; k < n; k++)
+				{
+					Plane_GP[j + k].u = pu[k];
+					Plane_GP[j + k].v = pv[k];
+					Plane_GP[j + k].BGRA = Vec8us{ uint16_t(pb[k]), uint16_t(pg[k]), uint16_t(pr[k]), 0, uint16_t(pb[k]), uint16_t(pg[k]), uint16_t(pr[k]), 0 };
+				}
+
+				Vec8f len = Vec8f().load_partial(n, LenTable + j);
+				// exactly one of Code/Gfx/Sfx is set
+				GridPointT *Dst;
+				Vec8i U, V;
+				if (Gfx)
+				{
+					Vec8i ti = truncatei((len / 120.0f - ST / 100.0f) * TRIG_FACTOR) & TRIG_MASK;
+					Twirl_UV(X, Y, gfxU, gfxV, GSinR1, GCosR1, lookup<TRIG_ACC>(ti, SinTable), lookup<TRIG_ACC>(ti, CosTable), 10.0f, U, V);
+					Dst = Gfx_GP;
+				}
+				else
+				{
+					Vec8i ti = truncatei((len / 200.0f + ST / 100.0f) * TRIG_FACTOR) & TRIG_MASK;
+					Vec8f S2 = lookup<TRIG_ACC>(ti, SinTable);
+					Twirl_UV(X, Y, codeU, codeV, CSinR1, CCosR1, Code ? S2 : -S2, lookup<TRIG_ACC>(ti, CosTable), 1.0f, U, V);
+					Dst = Code ? Code_GP : Sfx_GP;
+				}
+				U.store(tu);
+				V.store(tv);
+				for (int32_t k = 0; k < n; k++)
+				{
+					Dst[j + k].u = tu[k];
+					Dst[j + k].v = tv[k];
+				}
+			}
+		}
+	}
+
+	// Textures cell row k of the plane and the active overlay and blends
+	// them into FinalPage, on the calling thread.
+	void Shade_CellRow(int32_t k)
+	{
+		const size_t begin = size_t(k) * 8 * FinalSurf.BPSL;
+		const size_t end = begin + 8 * FinalSurf.BPSL;
+
+		GridRendererTG_Rows(Plane_GP, PlaneImage, (DWord *)Page1, xres, k, k + 1);
+		if (Code)
+		{
+			GridRendererT_Rows(Code_GP, CodeImage, (DWord *)Page2, xres, k, k + 1);
+			AlphaBlend_Span(Page1, Page2, nullptr, 0xa0a0a0, 0xa0a0a0, begin, end);
+			AlphaBlend_Span(Page2, FinalPage, nullptr, 0xa0a0a0, 0xb0b0b0, begin, end);
+		}
+		if (Gfx)
+		{
+			GridRendererT_Rows(Gfx_GP, GfxImage, (DWord *)Page3, xres, k, k + 1);
+			AlphaBlend_Span(Page1, Page3, nullptr, 0xa0a0a0, 0xd0d0d0, begin, end);
+			AlphaBlend_Span(Page3, FinalPage, nullptr, 0xa0a0a0, 0xb0b0b0, begin, end);
+		}
+		if (Sfx)
+		{
+			GridRendererT_Rows(Sfx_GP, SfxImage, (DWord *)Page4, xres, k, k + 1);
+			AlphaBlend_Span(Page1, Page4, nullptr, 0xa0a0a0, 0xa0a0a0, begin, end);
+			AlphaBlend_Span(Page4, FinalPage, nullptr, 0xa0a0a0, 0xb0b0b0, begin, end);
+		}
+	}
+
+	// Casts band b's grid rows, then shades every cell row whose corners
+	// are all cast. A band shades its inner rows while its neighbours are
+	// still casting; edge rows go to whichever neighbour finishes last.
+	void Run_Band(int32_t b)
+	{
+		const int32_t r0 = b * GLATO_BAND_ROWS;
+		const int32_t r1 = std::min(r0 + GLATO_BAND_ROWS, cellRows);
+		const bool last = b == numBands - 1;
+
+		Cast_Rows(r0, last ? r1 + 1 : r1);
+
+		if (b > 0 && Seams[b - 1].fetch_add(1, std::memory_order_acq_rel) == 1)
+			Shade_CellRow(r0 - 1);
+		for (int32_t k = r0; k < r1 - 1; k++)
+			Shade_CellRow(k);
+		if (last)
+			Shade_CellRow(r1 - 1);
+		else if (Seams[b].fetch_add(1, std::memory_order_acq_rel) == 1)
+			Shade_CellRow(r1 - 1);
+	}
+
 	bool tick() override {
 		if (Timer >= 3500) return false;
 
-		int x, y, i, j;
-		float a = 0.0f, bb = 0.0f, c = 0.0f, d = 0.0f;
-		float X1 = 0.0f, X2 = 0.0f;
-		float u, v, u1, v1, u2, v2, r, g, b;
-		float Code_R1 = 0.0f, Code_R2;
-		float CCosR1, CSinR1, CCosR2, CSinR2;
-		float Gfx_R1, Gfx_R2, GCosR1, GSinR1, GCosR2, GSinR2;
-		XMMVector Intersection1, Origin1, Direction1, U;
-		int X, Y;
-		float Radius = 1;
-		int Gfx = 0, Sfx = 0, Code = 1;
-		float ST;
+		float Code_R1, Gfx_R1;
 
 		bool skip = false;
 		// fast forward/rewind
@@ -289,6 +452,7 @@ struct GlatoScene : SceneDriver {
 		}
 		TTrd = Timer;
 
+		Code = 1; Gfx = 0; Sfx = 0;
 		if (Timer <= 100 * 11)
 			ST = (Timer*2500)/(1000+Timer);//  sqrt(Timer*1600);
 		if (Timer > 100 * 11){ Gfx = 1;Code = 0;
@@ -299,8 +463,6 @@ struct GlatoScene : SceneDriver {
 		}
 //		ST = (Timer*2000)/(1000+Timer);//  sqrt(Timer*1600);
 		Euler_Angles(CamMat.Data,Rx,Ry,Rz);
-		i=0;
-		j=0;
 		//code
 		Code_R1 = ST * 0.0005;
 		// back
@@ -323,288 +485,14 @@ struct GlatoScene : SceneDriver {
 			Gfx_RS = (ST) * 0.00001;
 
 
-		//Origin1.x=CameraPos.x;
-		//Origin1.y=CameraPos.y;
-		//Origin1.z=CameraPos.z;
-	
-		Radius = 1;
-		Origin1 = CameraPos;
 		// Clear page isn't required as wobbler overwrites entire screen / frame
-//		memset(VPage, 0, PageSize);
-		for (y=0;y<=yres;y+=8)
-			for (x=0;x<=xres;x+=8)
-			{
-				Direction1.x=x-(xres >> 1);
-				Direction1.y=y-(yres >> 1);
-				Direction1.z=256.0*XResFactor;
-				Direction1.w = .0f;
-				MatrixXVector(CamMat.Data,&Direction1,&U);
-				Direction1=U;
-				Direction1.Normalize();
-//				Radius = std::max(std::max(fabs(Direction1.y), fabs(Direction1.x)), fabs(Direction1.z));//1.0;//sin(Direction1.x) * cos(Direction1.z);
-				a=Radius-Origin1.y;
-				c=-Radius-Origin1.y;
-				d=Direction1.y;
-				
-				if (d<=0)
-				{
-					if (d == 0) {
-						X2 = 0;
-					} else {
-						X2 = c / d;
-					}
-					Intersection1 = Origin1 + Direction1 * X2;
-					//Intersection1.x = Origin1.x + Direction1.x * X2;
-					//Intersection1.y = Origin1.y + Direction1.y * X2;
-					//Intersection1.z = Origin1.z + Direction1.z * X2;
-
-					TrigOffset = (Intersection1.x + (float)(ST*0.1f) / 28.65f) * TRIG_FACTOR;
-					TrigOffset &= TRIG_MASK;
-					u = (Intersection1.x + CosTable[TrigOffset] * 0.5f)*0.5f;
-					TrigOffset = (Intersection1.z + (float)(ST*0.1f) / 28.65f) * TRIG_FACTOR;
-					TrigOffset &= TRIG_MASK;
-					v = (Intersection1.z + SinTable[TrigOffset] * 0.5f)*0.5f;
-
-
-					//u=(Intersection1.x+cos(Intersection1.z+(float)(ST*0.1f)/28.65f)*0.5f)*0.5f;
-					//v=(Intersection1.z+sin(Intersection1.x+(float)(ST*0.1f)/28.65f)*0.5f)*0.5f;
-					//Intersection1.x-=Origin1.x;
-					//Intersection1.y-=Origin1.y;
-					//Intersection1.z-=Origin1.z;
-					Intersection1 -= Origin1;
-					//r=(sqrt(Intersection1.x*Intersection1.x+Intersection1.y*Intersection1.y+Intersection1.z*Intersection1.z)*32);
-					r = Intersection1.Length() * 32.f;
-					//r*= 1.8;//1.3;
-					if (r>253.0f) r=253.0f;
-					r=255.0f-r;
-					if (r<2.0f) r=2.0f;
-					b=r * 0.7f;
-					g= r*0.8f;
-					//r*= 0.5;
-					//g-=Timer /(40 * 4);
-					//b-=Timer /(80 * 4);
-					//g-=Frames /10;
-					//b-=Frames /20;
-
-					if (g>254.0f) g=254.0f;
-					if (g<1.0f) g=1.0f;
-					if (b>254.0f) b=254.0f;
-					if (b<1.0f) b=1.0f;
-
-					u*=256.0f;
-					v*=256.0f;
-				}
-				else
-				{
-					X1=a/d;
-					//Intersection1.x = Origin1.x + Direction1.x * X1;
-					//Intersection1.y = Origin1.y + Direction1.y * X1;
-					//Intersection1.z = Origin1.z + Direction1.z * X1;
-					Intersection1 = Origin1 + Direction1 * X1;
-
-					TrigOffset = (Intersection1.x + (float)(ST*0.1f) / 28.65f) * TRIG_FACTOR;
-					TrigOffset &= TRIG_MASK;
-					u = (Intersection1.x + CosTable[TrigOffset] * 0.5f)*0.5f;
-					TrigOffset = (Intersection1.z + (float)(ST*0.1f) / 28.65f) * TRIG_FACTOR;
-					TrigOffset &= TRIG_MASK;
-					v = (Intersection1.z + SinTable[TrigOffset] * 0.5f)*0.5f;
-					//u=(Intersection1.x+cos(Intersection1.z+(float)(ST*0.1f)/28.65f)*0.5f)*0.5f;
-					//v=(Intersection1.z+sin(Intersection1.x+(float)(ST*0.1f)/28.65f)*0.5f)*0.5f;
-					//Intersection1.x-=Origin1.x;
-					//Intersection1.y-=Origin1.y;
-					//Intersection1.z-=Origin1.z;
-					Intersection1 -= Origin1;
-					r = Intersection1.Length() * 32.f;
-					//r=(sqrt(Intersection1.x*Intersection1.x+Intersection1.y*Intersection1.y+Intersection1.z*Intersection1.z) * 32);
-//					if (r < 0.0f)
-//						r = 0;
-//					else
-//						r = sqrt(r);
-					//r*= 1.8;//1.3;
-					r=255.0f-r;
-					if (r>253.0f) r=253.0f;
-					if (r<2.0f) r=2.0f;
-					b=r * 0.7f;
-					g= r*0.8f;
-					//r*=0.5;
-					//g-=Timer /(40 * 4);
-					//b-=Timer /(80 * 4);
-					//g-=Frames /10;
-					//b-=Frames /20;
-
-					if (g>254.0f) g=254.0f;
-					if (g<1.0f) g=1.0f;
-					if (b>254.0f) b=254.0f;
-					if (b<1.0f) b=1.0f;
-
-					u*=256.0f;
-					v*=256.0f;
-				}
-				//r = 0; // green
-				//g = 0; // red
-				//b = g = r; // blue
-
-				//r*=254.0f;
-				//g*=254.0f;
-				//b*=254.0f;
-				r*=63.0f;
-				g*=63.0f;
-				b*=63.0f;
-
-				Plane_GP[j].u=u;
-				Plane_GP[j].v=v;
-				Plane_GP[j].BGRA = Vec8us{ uint16_t(b) , uint16_t(g), uint16_t(r) , 0, uint16_t(b) , uint16_t(g), uint16_t(r) , 0};
-
-
-				X = x - xres * 0.5;
-				Y = y - yres * 0.5;
-
-				if (Code)
-				{
-//					Code_R2 = sqrt(X*X + Y*Y) / (200.0f*XResFactor)+ST /100.0f;
-//					CCosR2 = cos (Code_R2);
-//					CSinR2 = sin (Code_R2);
-					Code_R2 = LenTable[j] / 200.0f + ST/100.0f;					
-					TrigOffset = Code_R2 * TRIG_FACTOR;
-					TrigOffset &= TRIG_MASK;
-					CCosR2 = CosTable[TrigOffset];
-					CSinR2 = SinTable[TrigOffset];
-
-
-					u = X * (204.8f * rXResFactor) * -(Code_RS * 5);
-					v = Y * (327.68f * rYResFactor) * -(Code_RS * 5);
-
-					u1 = (u) * CSinR1  + (v) * CCosR1;
-					v1 = (u) * CCosR1  - (v) * CSinR1;
-
-					u2 = (u1) * CSinR2  + (v1) * CCosR2;
-					v2 = (u1) * CCosR2  - (v1) * CSinR2;
-
-//					r = g = b = 127.0f;
-
-					r*=254.0f;
-					g*=254.0f;
-					b*=254.0f;
-
-					Code_GP[j].u=u2+32767;
-					Code_GP[j].v=v2+32767;
-					if (Code_GP[j].u > 65535) Code_GP[j].u = 65535;
-					if (Code_GP[j].v > 65535) Code_GP[j].v = 65535;
-					if (Code_GP[j].u < 0) Code_GP[j].u = 0;
-					if (Code_GP[j].v < 0) Code_GP[j].v = 0;
-//					Code_GP[j].R=r;
-//					Code_GP[j].G=g;
-//					Code_GP[j].B=b;
-				}
-
-				if (Gfx)
-				{
-//					Gfx_R2 = sqrt(X*X + Y*Y) / (120.0 * XResFactor) - (ST) /(100.0);
-//					GCosR2 = cos (Gfx_R2);
-//					GSinR2 = sin (Gfx_R2);
-					Gfx_R2 = LenTable[j] / 120.0f - ST/100.0f;
-					TrigOffset = Gfx_R2 * TRIG_FACTOR;
-					TrigOffset &= TRIG_MASK;
-					GCosR2 = CosTable[TrigOffset];
-					GSinR2 = SinTable[TrigOffset];
-
-
-					u = X * (204.8*rXResFactor) * (Gfx_RS*20.0);
-					v = Y * (327.68*rYResFactor) * (Gfx_RS*20.0);
-
-					u1 = (u) * GSinR1  + (v) * GCosR1;
-					v1 = (u) * GCosR1  - (v) * GSinR1;
-
-					u1*=10.0;	v1*=10.0;
-
-					u2 = (u1) * GSinR2  + (v1) * GCosR2;
-					v2 = (u1) * GCosR2  - (v1) * GSinR2;
-
-//					r = g = b = 127.0;
-
-					r*=254.0;
-					g*=254.0;
-					b*=254.0;
-
-					Gfx_GP[j].u=u2+32767;
-					Gfx_GP[j].v=v2+32767;
-					if (Gfx_GP[j].u > 65535) Gfx_GP[j].u = 65535;
-					if (Gfx_GP[j].v > 65535) Gfx_GP[j].v = 65535;
-					if (Gfx_GP[j].u < 0) Gfx_GP[j].u = 0;
-					if (Gfx_GP[j].v < 0) Gfx_GP[j].v = 0;
-//					Gfx_GP[j].R=r;
-//					Gfx_GP[j].G=g;
-//					Gfx_GP[j].B=b;
-				}
-		
-				if (Sfx)
-				{
-//					Code_R2 = sqrt(X*X + Y*Y) / (200.0*XResFactor)+ST /100.0;
-//					CCosR2 = cos (-Code_R2);
-//					CSinR2 = sin (-Code_R2);
-					Code_R2 = LenTable[j] / 200.0f + ST/100.0f;
-					TrigOffset = Code_R2 * TRIG_FACTOR;
-					TrigOffset &= TRIG_MASK;
-					CCosR2 = CosTable[TrigOffset];
-					CSinR2 =-SinTable[TrigOffset];
-
-					u = X * (204.8*rXResFactor) * -(Code_RS * 5);
-					v = Y * (327.68*rYResFactor) * -(Code_RS * 5);
+		for (int32_t k = 0; k < numBands; k++)
+			Seams[k].store(0, std::memory_order_relaxed);
+		ThreadPool::instance().parallel_for(numBands, 1, [this](size_t begin, size_t end) {
+			for (size_t k = begin; k < end; k++)
+				Run_Band(k);
+		});
 
-					u1 = (u) * CSinR1  + (v) * CCosR1;
-					v1 = (u) * CCosR1  - (v) * CSinR1;
-
-					u2 = (u1) * CSinR2  + (v1) * CCosR2;
-					v2 = (u1) * CCosR2  - (v1) * CSinR2;
-
-//					r = g = b = 127.0;
-
-					r*=254.0;
-					g*=254.0;
-					b*=254.0;
-
-					Sfx_GP[j].u=u2+32767;
-					Sfx_GP[j].v=v2+32767;
-
-//					Sfx_GP[j].R=r;
-//					Sfx_GP[j].G=g;
-//					Sfx_GP[j].B=b;
-
-					if (Sfx_GP[j].u > 65535) Sfx_GP[j].u = 65535;
-					if (Sfx_GP[j].v > 65535) Sfx_GP[j].v = 65535;
-					if (Sfx_GP[j].u < 0) Sfx_GP[j].u = 0;
-					if (Sfx_GP[j].v < 0) Sfx_GP[j].v = 0;
-				}
-				j++;
-			}
-
-//		Grid_Texture_Mapper_XXX(Plane_GP,PlaneImage,(DWord *)Page1);
-		Grid_Texture_Mapper_TG(Plane_GP,PlaneImage,(DWord *)Page1, xres, yres);
-		//GridRendererTG(Plane_GP,PlaneImage,(DWord *)Page1, XRes, YRes);
-
-		if (Code)
-		{
-//			Grid_Texture_Mapper_XXX(Code_GP,CodeImage,(DWord *)Page2);
-			GridRendererT(Code_GP,CodeImage,(DWord *)Page2, Surf1.X, Surf1.Y);
-			//Grid_Texture_Mapper_T(Code_GP, CodeImage, (DWord *)Page2);
-			Modulate(&Surf1,&Surf2,0xa0a0a0,0xa0a0a0, Surf1.PageSize);
-			Modulate(&Surf2,&FinalSurf,0xa0a0a0, 0xb0b0b0, Surf2.PageSize);
-		}
-		if (Gfx)
-		{
-//			Grid_Texture_Mapper_XXX(Gfx_GP,GfxImage,(DWord *)Page3);
-			GridRendererT(Gfx_GP,GfxImage,(DWord *)Page3, Surf3.X, Surf3.Y);
-			Modulate(&Surf1,&Surf3,0xa0a0a0, 0xd0d0d0, Surf1.PageSize);
-			Modulate(&Surf3,&FinalSurf,0xa0a0a0, 0xb0b0b0, Surf3.PageSize);
- //			Modulate(&Surf2,&Surf3,0xa0a0a0,0xa0a0a0);
-		}
-		if (Sfx)
-		{
-//			Grid_Texture_Mapper_XXX(Sfx_GP,SfxImage,(DWord *)Page4);
-			GridRendererT(Sfx_GP,SfxImage,(DWord *)Page4, Surf4.X, Surf4.Y);
-			Modulate(&Surf1,&Surf4,0xa0a0a0,0xa0a0a0, Surf1.PageSize);
-			Modulate(&Surf4,&FinalSurf,0xa0a0a0, 0xb0b0b0, Surf4.PageSize);
-		}
 //		memcpy(VPage, Page1, PageSize);
 		if (Timer>3200)
 		{
@@ -0,0 +1,156 @@
+#include "Rain.h"
+
+#include "Base/FDS_DECS.H"
+#include <Threads.h>
+
+#include "simde/x86/avx2.h"
+#include <simd/vectorclass.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace rainns {
+	struct Streak
+	{
+		float x1, y1, x2, y2;
+		float rdy, dxdy;
+	};
+
+	std::vector<Streak> streaks;
+	// per tile indices into streaks, in queue order
+	std::vector<std::vector<dword>> tileBins;
+	std::vector<dword> usedTiles;
+	int32_t tilesX = 0, tilesY = 0;
+
+	// footprint weights in quarters of A, lanes relative to ix-2
+	const Vec8i footprint(1, 3, 4, 3, 1, 0, 0, 0);
+
+	void Setup_Tiles()
+	{
+		int32_t tx = (XRes + RAIN_TILE - 1) >> RAIN_TILE_LOG;
+		int32_t ty = (YRes + RAIN_TILE - 1) >> RAIN_TILE_LOG;
+		if (tx != tilesX || ty != tilesY)
+		{
+			tilesX = tx;
+			tilesY = ty;
+			tileBins.assign(tx * ty, {});
+		}
+	}
+
+	// Blends 8 pixels starting at Row[0] towards the rain colour with
+	// per-pixel weights a (0..255). Lanes outside Mask are left untouched.
+	inline void Blend8(dword *Row, Vec8i a, Vec8ib Mask)
+	{
+		const __m256i mask = Mask;
+		const __m256i color = _mm256_set1_epi64x(0x0000007F008F00AFLL);	// B,G,R,X as words
+		const __m256i zero = _mm256_setzero_si256();
+
+		__m256i pixels = _mm256_maskload_epi32((const int *)Row, mask);
+
+		// a per pixel, replicated over its 4 channel words
+		__m256i a8 = _mm256_shuffle_epi8(a, _mm256_set_epi8(
+			12,12,12,12, 8,8,8,8, 4,4,4,4, 0,0,0,0,
+			12,12,12,12, 8,8,8,8, 4,4,4,4, 0,0,0,0));
+		__m256i al = _mm256_unpacklo_epi8(a8, zero);
+		__m256i ah = _mm256_unpackhi_epi8(a8, zero);
+		__m256i ial = _mm256_sub_epi16(_mm256_set1_epi16(255), al);
+		__m256i iah = _mm256_sub_epi16(_mm256_set1_epi16(255), ah);
+
+		__m256i pl = _mm256_unpacklo_epi8(pixels, zero);
+		__m256i ph = _mm256_unpackhi_epi8(pixels, zero);
+
+		// (c*(255-a) + a*k) >> 8 stays within 16 bits
+		pl = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(pl, ial), _mm256_mullo_epi16(al, color)), 8);
+		ph = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(ph, iah), _mm256_mullo_epi16(ah, color)), 8);
+
+		__m256i result = _mm256_and_si256(_mm256_packus_epi16(pl, ph), _mm256_set1_epi32(0x00FFFFFF));
+		_mm256_maskstore_epi32((int *)Row, mask, result);
+	}
+
+	void Render_Tile(dword Tile)
+	{
+		const int32_t tx0 = (Tile % tilesX) << RAIN_TILE_LOG;
+		const int32_t ty0 = (Tile / tilesX) << RAIN_TILE_LOG;
+		const int32_t tx1 = std::min(tx0 + RAIN_TILE, XRes);
+		const int32_t ty1 = std::min(ty0 + RAIN_TILE, YRes);
+		const Vec8i lane(0, 1, 2, 3, 4, 5, 6, 7);
+
+		for (dword index : tileBins[Tile])
+		{
+			const Streak &S = streaks[index];
+
+			int32_t iy1 = std::max<int32_t>(Fist(S.y1), ty0);
+			int32_t iy2 = std::min<int32_t>(Fist(S.y2), ty1);
+
+			dword *scanline = (dword *)VPage + iy1 * XRes;
+			for (int32_t y = iy1; y < iy2; y++, scanline += XRes)
+			{
+				float dy = y - S.y1;
+				float lt = dy * S.rdy;
+				int32_t ix = Fist(S.x1 + dy * S.dxdy);
+
+				float fA = lt < 0.7f ? lt * (0xFF / 0.7f) : (1.0f - lt) * (0xFF / 0.3f);
+				int32_t A = std::clamp<int32_t>(fA, 0, 0xFF);
+
+				// footprint is ix-2..ix+2, clipped to the tile
+				int32_t x = ix - 2;
+				Vec8i px = lane + x;
+				Vec8ib mask = (px >= tx0) & (px < tx1) & (lane < 5);
+				if (!horizontal_or(mask)) continue;
+
+				Blend8(scanline + x, (footprint * A) >> 2, mask);
+			}
+		}
+	}
+}
+
+void Rain_Begin()
+{
+	using namespace rainns;
+	streaks.clear();
+	for (dword tile : usedTiles)
+		tileBins[tile].clear();
+	usedTiles.clear();
+}
+
+void Rain_Queue(float x1, float y1, float x2, float y2)
+{
+	using namespace rainns;
+	if (!(y2 > y1) || y2 < 0 || y1 >= YRes) return;
+
+	float left = std::min(x1, x2) - 3.0f, right = std::max(x1, x2) + 3.0f;
+	if (right < 0 || left >= XRes) return;
+
+	Streak S;
+	S.x1 = x1; S.y1 = y1; S.x2 = x2; S.y2 = y2;
+	S.rdy = 1.0f / (y2 - y1);
+	S.dxdy = (x2 - x1) * S.rdy;
+
+	if (streaks.empty()) Setup_Tiles();
+	dword index = streaks.size();
+	streaks.push_back(S);
+
+	int32_t cx1 = std::max<int32_t>(left, 0) >> RAIN_TILE_LOG;
+	int32_t cx2 = std::min<int32_t>(right, XRes - 1) >> RAIN_TILE_LOG;
+	int32_t cy1 = std::max<int32_t>(y1, 0) >> RAIN_TILE_LOG;
+	int32_t cy2 = std::min<int32_t>(y2, YRes - 1) >> RAIN_TILE_LOG;
+
+	for (int32_t ty = cy1; ty <= cy2; ty++)
+		for (int32_t tx = cx1; tx <= cx2; tx++)
+		{
+			auto &bin = tileBins[ty * tilesX + tx];
+			if (bin.empty()) usedTiles.push_back(ty * tilesX + tx);
+			bin.push_back(index);
+		}
+}
+
+void Rain_Flush()
+{
+	using namespace rainns;
+	ThreadPool::instance().parallel_for(usedTiles.size(), 1, [](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++)
+			Render_Tile(usedTiles[i]);
+	});
+	Rain_Begin();
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "Base/FDS_VARS.H"
+
+// Batched rain streaks.
+//
+// Fillers queue screen-space streaks during the particle post-pass;
+// Rain_Flush then bins them into RAIN_TILE x RAIN_TILE screen tiles and
+// draws every tile as one pool job. A streak runs from its tail (x1,y1)
+// down to its head (x2,y2); each scanline blends a 5 pixel wide footprint
+// (weights A/4, 3A/4, A, 3A/4, A/4) towards the rain colour, where A ramps
+// up to 0xFF at 70% of the streak and back down to 0 at the head.
+// Streaks in a tile are drawn in queue order, so overlaps blend the same
+// way a serial pass would.
+
+#define RAIN_TILE_LOG 7
+#define RAIN_TILE (1 << RAIN_TILE_LOG)
+
+// Drops all queued streaks without drawing them.
+void Rain_Begin();
+
+// Queues a streak; needs y2 > y1. Not thread safe: queue from one thread.
+void Rain_Queue(float x1, float y1, float x2, float y2);
+
+// Blends every queued streak into VPage (32bpp) and empties the queue.
+void Rain_Flush();
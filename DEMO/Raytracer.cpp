@@ -1,106 +1,405 @@
 /*
 	antialiasing mesh raytracer, intended to support glow effect and transparency.
 	[10.09.02] Version 0.01: basic version operative
+	Version 0.02: per-mesh SAH BVH + top level BVH over mesh instances,
+	8-wide ray packets, rows spread across the thread pool.
 */
 
 #include "Rev.h"
+#include "Threads.h"
 
-static void rayFaceIsect(rtIntersection &isect, rtLocalRay &ray, Face *F)
+#include <algorithm>
+#include <cassert>
+#include <unordered_map>
+#include <vector>
+
+#include "simde/x86/avx2.h"
+#include <simd/vectorclass.h>
+
+namespace rt {
+
+constexpr int32_t PACKET_SIZE = 8;
+constexpr int32_t SAH_BINS = 12;
+constexpr uint32_t MAX_LEAF_PRIMS = 4;
+// Traversal stack size. The builder stops splitting at depth MAX_STACK-1,
+// which bounds the stack, since a poorly balanced SAH split can peel off
+// one primitive at a time.
+constexpr int32_t MAX_STACK = 64;
+
+struct AABB
 {
-	float dot = ray.direction * F->N;
-	if (fabs(dot)<1E-09) return;
+	float min[3] = { 1E+38f, 1E+38f, 1E+38f };
+	float max[3] = { -1E+38f, -1E+38f, -1E+38f };
+
+	void grow(float x, float y, float z)
+	{
+		min[0] = std::min(min[0], x); max[0] = std::max(max[0], x);
+		min[1] = std::min(min[1], y); max[1] = std::max(max[1], y);
+		min[2] = std::min(min[2], z); max[2] = std::max(max[2], z);
+	}
+
+	void grow(const Vector &v) { grow(v.x, v.y, v.z); }
 
-	float t = ((F->A->Pos - ray.position)*F->N) / dot;
+	void grow(const AABB &b)
+	{
+		for (int32_t a = 0; a < 3; a++)
+		{
+			min[a] = std::min(min[a], b.min[a]);
+			max[a] = std::max(max[a], b.max[a]);
+		}
+	}
 
-	if (t < 1E-06 || isect.t < t)
-		return;
+	float area() const
+	{
+		float ex = max[0] - min[0], ey = max[1] - min[1], ez = max[2] - min[2];
+		if (ex < 0) return 0.0f;
+		return 2.0f * (ex * ey + ey * ez + ez * ex);
+	}
 
-	Vector p = ray.position + t * ray.direction - F->A->Pos;
-	
-	Vector u, v;
-	u = F->B->Pos - F->A->Pos;
-	v = F->C->Pos - F->A->Pos;
+	float center(int32_t a) const { return 0.5f * (min[a] + max[a]); }
+};
 
-	float det, a, b;
+// count == 0: interior node, children at first and first+1.
+// count > 0: leaf over prims[first .. first+count).
+struct BVHNode
+{
+	AABB box;
+	uint32_t first = 0;
+	uint32_t count = 0;
+	uint32_t axis = 0;
+};
 
-	det = u.x * v.y - u.y * v.x;
-	if (fabs(det) < 1E-12)
+// Binned SAH builder, shared by the mesh and instance levels.
+struct BVH
+{
+	std::vector<BVHNode> nodes;
+	std::vector<uint32_t> prims;
+
+	void build(const std::vector<AABB> &bounds)
+	{
+		nodes.clear();
+		prims.resize(bounds.size());
+		for (uint32_t i = 0; i < prims.size(); i++) prims[i] = i;
+		if (bounds.empty()) return;
+
+		nodes.reserve(bounds.size() * 2);
+		nodes.emplace_back();
+		nodes[0].first = 0;
+		nodes[0].count = (uint32_t)bounds.size();
+		subdivide(0, bounds, 0);
+	}
+
+private:
+	void subdivide(uint32_t index, const std::vector<AABB> &bounds, int32_t depth)
 	{
-		det = 1.0 / (u.x * v.z - u.z * v.z);
+		BVHNode &node = nodes[index];
+		AABB centroids;
+		for (uint32_t i = node.first; i < node.first + node.count; i++)
+		{
+			const AABB &b = bounds[prims[i]];
+			node.box.grow(b);
+			centroids.grow(b.center(0), b.center(1), b.center(2));
+		}
+		if (node.count <= MAX_LEAF_PRIMS || depth >= MAX_STACK - 1) return;
 
-		a = (p.x * v.z - p.z * v.x) * det;
-		b = (u.x * p.z - u.z * p.x) * det;
-	} else {
-		det = 1.0 / det;
+		// pick the cheapest bin boundary over all three axes
+		float bestCost = node.count * node.box.area();
+		int32_t bestAxis = -1, bestSplit = 0;
+		for (int32_t a = 0; a < 3; a++)
+		{
+			float extent = centroids.max[a] - centroids.min[a];
+			if (extent <= 0) continue;
+			float scale = SAH_BINS / extent;
+
+			AABB binBox[SAH_BINS];
+			uint32_t binCount[SAH_BINS] = { 0 };
+			for (uint32_t i = node.first; i < node.first + node.count; i++)
+			{
+				const AABB &b = bounds[prims[i]];
+				int32_t bin = std::min(SAH_BINS - 1, (int32_t)((b.center(a) - centroids.min[a]) * scale));
+				binCount[bin]++;
+				binBox[bin].grow(b);
+			}
+
+			float rightArea[SAH_BINS];
+			uint32_t rightCount[SAH_BINS];
+			AABB acc;
+			uint32_t n = 0;
+			for (int32_t i = SAH_BINS - 1; i > 0; i--)
+			{
+				acc.grow(binBox[i]);
+				n += binCount[i];
+				rightArea[i] = acc.area();
+				rightCount[i] = n;
+			}
+
+			acc = AABB();
+			n = 0;
+			for (int32_t i = 0; i < SAH_BINS - 1; i++)
+			{
+				acc.grow(binBox[i]);
+				n += binCount[i];
+				if (!n || !rightCount[i + 1]) continue;
+				float cost = n * acc.area() + rightCount[i + 1] * rightArea[i + 1];
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestAxis = a;
+					bestSplit = i + 1;
+				}
+			}
+		}
+		if (bestAxis < 0) return;
 
-		a = (p.x * v.y - p.y * v.x) * det;
-		b = (u.x * p.y - u.y * p.x) * det;
+		float scale = SAH_BINS / (centroids.max[bestAxis] - centroids.min[bestAxis]);
+		auto mid = std::partition(prims.begin() + node.first, prims.begin() + node.first + node.count, [&](uint32_t p) {
+			int32_t bin = std::min(SAH_BINS - 1, (int32_t)((bounds[p].center(bestAxis) - centroids.min[bestAxis]) * scale));
+			return bin < bestSplit;
+		});
+		uint32_t leftCount = (uint32_t)(mid - prims.begin()) - node.first;
+
+		uint32_t left = (uint32_t)nodes.size();
+		nodes.emplace_back();
+		nodes.emplace_back();
+		// emplace_back may have moved the array
+		BVHNode &parent = nodes[index];
+		nodes[left].first = parent.first;
+		nodes[left].count = leftCount;
+		nodes[left + 1].first = parent.first + leftCount;
+		nodes[left + 1].count = parent.count - leftCount;
+		parent.first = left;
+		parent.count = 0;
+		parent.axis = bestAxis;
+
+		subdivide(left, bounds, depth + 1);
+		subdivide(left + 1, bounds, depth + 1);
 	}
+};
+
+// Object space triangles in BVH order, A + edges for Moeller-Trumbore.
+struct MeshBVH
+{
+	const Face *Faces = nullptr;
+	DWord FIndex = 0;
+	BVH bvh;
+	std::vector<Vector> A, E1, E2;
+	std::vector<Face *> F;
+};
 
-	if (a < 0 || b < 0 || a+b > 1) return;
+// Mesh BVHs are built once, in object space; meshes are assumed rigid.
+// Entries are dropped by GlowRaytracer_Release when their scene goes away.
+static std::unordered_map<const TriMesh *, MeshBVH> meshes;
 
-	isect.t = t;
-	isect.u = a;
-	isect.v = b;
-	isect.F = F;	
+static const MeshBVH &meshBVH(TriMesh *T)
+{
+	MeshBVH &M = meshes[T];
+	if (M.Faces == T->Faces && M.FIndex == T->FIndex) return M;
+
+	M.Faces = T->Faces;
+	M.FIndex = T->FIndex;
+
+	std::vector<AABB> bounds(T->FIndex);
+	for (DWord i = 0; i < T->FIndex; i++)
+	{
+		Face *F = T->Faces + i;
+		bounds[i].grow(F->A->Pos);
+		bounds[i].grow(F->B->Pos);
+		bounds[i].grow(F->C->Pos);
+	}
+	M.bvh.build(bounds);
+
+	M.A.resize(T->FIndex);
+	M.E1.resize(T->FIndex);
+	M.E2.resize(T->FIndex);
+	M.F.resize(T->FIndex);
+	for (DWord i = 0; i < T->FIndex; i++)
+	{
+		Face *F = T->Faces + M.bvh.prims[i];
+		M.A[i] = F->A->Pos;
+		M.E1[i] = F->B->Pos - F->A->Pos;
+		M.E2[i] = F->C->Pos - F->A->Pos;
+		M.F[i] = F;
+	}
+	return M;
 }
 
-static Color raytrace(Scene *Sc, Vector *position, Vector *direction)
+struct Instance
 {
 	TriMesh *T;
-	Face *F, *FE;
-	Color ref, col;
-	rtIntersection isect;
-	Vector u;
-
-	isect.F = NULL;
-	isect.T = NULL;
-	isect.t = 1E+38; // should calculate t based on far-Z clipping plane? maybe not.
-	isect.u = 0;
-	isect.v = 0;
-
-	for(T=Sc->TriMeshHead; T; T=T->Next)
-	{		
-		if (!(T->Flags&HTrack_Visible)) continue;
-
-		rtLocalRay ray;
-		// xform (position, direction) to object space.
-		u.sub(*position, T->IPos);
-		float l2 = 1.0/Vector_SelfDot((Vector *)T->RotMat);
-		
-		MatrixTXVector(T->RotMat, &u, &ray.position);
-		ray.position *= l2;
-
-		MatrixTXVector(T->RotMat, direction, &ray.direction);
-		ray.direction *= l2;
-
-		for(F = T->Faces, FE = F + T->FIndex; F<FE; F++)
+	const MeshBVH *M;
+	float l2; // 1/scale^2 of RotMat
+};
+
+// Rebuilt every frame over the visible meshes' world space boxes.
+struct SceneBVH
+{
+	BVH bvh;
+	std::vector<Instance> instances;
+
+	void build(Scene *Sc)
+	{
+		instances.clear();
+		std::vector<AABB> bounds;
+		for (TriMesh *T = Sc->TriMeshHead; T; T = T->Next)
 		{
-			rayFaceIsect(isect, ray, F);
+			if (!(T->Flags & HTrack_Visible) || !T->FIndex) continue;
+			const MeshBVH &M = meshBVH(T);
+
+			// world = IPos + RotMat * local, over the corners of the root box
+			const AABB &root = M.bvh.nodes[0].box;
+			AABB world;
+			for (int32_t c = 0; c < 8; c++)
+			{
+				float x = (c & 1) ? root.max[0] : root.min[0];
+				float y = (c & 2) ? root.max[1] : root.min[1];
+				float z = (c & 4) ? root.max[2] : root.min[2];
+				world.grow(
+					T->IPos.x + T->RotMat[0][0] * x + T->RotMat[0][1] * y + T->RotMat[0][2] * z,
+					T->IPos.y + T->RotMat[1][0] * x + T->RotMat[1][1] * y + T->RotMat[1][2] * z,
+					T->IPos.z + T->RotMat[2][0] * x + T->RotMat[2][1] * y + T->RotMat[2][2] * z);
+			}
+			bounds.push_back(world);
+			instances.push_back({ T, &M, 1.0f / Vector_SelfDot((Vector *)T->RotMat) });
 		}
+		bvh.build(bounds);
 	}
+};
+
+struct Packet
+{
+	Vec8f o[3], d[3];
+	Vec8fb active;
+	// nearest hit; t is the same in world and object space since the
+	// object space direction carries the 1/scale too.
+	Vec8f t, u, v;
+	Face *F[PACKET_SIZE];
+};
 
-	if (isect.F == NULL)
+// Lanes whose ray enters the box before their current nearest hit.
+static inline Vec8fb hitBox(const AABB &b, const Vec8f o[3], const Vec8f id[3], const Vec8f &t, const Vec8fb &active)
+{
+	Vec8f t1 = (Vec8f(b.min[0]) - o[0]) * id[0];
+	Vec8f t2 = (Vec8f(b.max[0]) - o[0]) * id[0];
+	Vec8f tmin = min(t1, t2), tmax = max(t1, t2);
+	for (int32_t a = 1; a < 3; a++)
 	{
-		col.R = 0.0;
-		col.G = 0.0;
-		col.B = 0.0;
-		col.A = 0.0;
-		return col;
+		t1 = (Vec8f(b.min[a]) - o[a]) * id[a];
+		t2 = (Vec8f(b.max[a]) - o[a]) * id[a];
+		tmin = max(tmin, min(t1, t2));
+		tmax = min(tmax, max(t1, t2));
 	}
+	return active & (tmin <= tmax) & (tmax >= 0.0f) & (tmin < t);
+}
 
-	// calculate color (based on gouraud, and a trilinear texture sampler)	
-	col.R = isect.F->A->LR
-		+ (isect.F->B->LR - isect.F->A->LR) * isect.u
-		+ (isect.F->C->LR - isect.F->A->LR) * isect.v;
-			
-	col.G = isect.F->A->LG
-		+ (isect.F->B->LG - isect.F->A->LG) * isect.u
-		+ (isect.F->C->LG - isect.F->A->LG) * isect.v;
+static void traverseMesh(const Instance &I, Packet &P)
+{
+	TriMesh *T = I.T;
+	const MeshBVH &M = *I.M;
 
-	col.B = isect.F->A->LB
-		+ (isect.F->B->LB - isect.F->A->LB) * isect.u
-		+ (isect.F->C->LB - isect.F->A->LB) * isect.v;
+	// xform (position, direction) to object space.
+	Vec8f u[3] = { P.o[0] - T->IPos.x, P.o[1] - T->IPos.y, P.o[2] - T->IPos.z };
+	Vec8f o[3], d[3], id[3];
+	for (int32_t a = 0; a < 3; a++)
+	{
+		o[a] = (T->RotMat[0][a] * u[0] + T->RotMat[1][a] * u[1] + T->RotMat[2][a] * u[2]) * I.l2;
+		d[a] = (T->RotMat[0][a] * P.d[0] + T->RotMat[1][a] * P.d[1] + T->RotMat[2][a] * P.d[2]) * I.l2;
+		id[a] = 1.0f / d[a];
+	}
+
+	uint32_t stack[MAX_STACK];
+	int32_t sp = 0;
+	stack[sp++] = 0;
+	while (sp)
+	{
+		const BVHNode &node = M.bvh.nodes[stack[--sp]];
+		if (!horizontal_or(hitBox(node.box, o, id, P.t, P.active))) continue;
+
+		if (node.count == 0)
+		{
+			assert(sp + 2 <= MAX_STACK);
+			// near child on top, judged by the packet's first ray
+			if (d[node.axis][0] < 0)
+			{
+				stack[sp++] = node.first;
+				stack[sp++] = node.first + 1;
+			} else {
+				stack[sp++] = node.first + 1;
+				stack[sp++] = node.first;
+			}
+			continue;
+		}
+
+		for (uint32_t i = node.first; i < node.first + node.count; i++)
+		{
+			const Vector &A = M.A[i], &E1 = M.E1[i], &E2 = M.E2[i];
+
+			// pvec = d x E2
+			Vec8f px = d[1] * E2.z - d[2] * E2.y;
+			Vec8f py = d[2] * E2.x - d[0] * E2.z;
+			Vec8f pz = d[0] * E2.y - d[1] * E2.x;
+			Vec8f det = px * E1.x + py * E1.y + pz * E1.z;
+			Vec8f inv = 1.0f / det;
+
+			Vec8f tx = o[0] - A.x, ty = o[1] - A.y, tz = o[2] - A.z;
+			Vec8f a = (tx * px + ty * py + tz * pz) * inv;
+
+			// qvec = tvec x E1
+			Vec8f qx = ty * E1.z - tz * E1.y;
+			Vec8f qy = tz * E1.x - tx * E1.z;
+			Vec8f qz = tx * E1.y - ty * E1.x;
+			Vec8f b = (d[0] * qx + d[1] * qy + d[2] * qz) * inv;
+			Vec8f t = (qx * E2.x + qy * E2.y + qz * E2.z) * inv;
+
+			Vec8fb hit = P.active & (abs(det) > 1E-12f) & (a >= 0.0f) & (b >= 0.0f) & (a + b <= 1.0f) & (t >= 1E-06f) & (t < P.t);
+			int32_t bits = to_bits(hit);
+			if (!bits) continue;
+
+			P.t = select(hit, t, P.t);
+			P.u = select(hit, a, P.u);
+			P.v = select(hit, b, P.v);
+			for (int32_t l = 0; l < PACKET_SIZE; l++)
+			{
+				if (bits & (1 << l)) P.F[l] = M.F[i];
+			}
+		}
+	}
+}
+
+static void traverse(const SceneBVH &S, Packet &P)
+{
+	if (S.bvh.nodes.empty()) return;
+
+	Vec8f id[3] = { 1.0f / P.d[0], 1.0f / P.d[1], 1.0f / P.d[2] };
+
+	uint32_t stack[MAX_STACK];
+	int32_t sp = 0;
+	stack[sp++] = 0;
+	while (sp)
+	{
+		const BVHNode &node = S.bvh.nodes[stack[--sp]];
+		if (!horizontal_or(hitBox(node.box, P.o, id, P.t, P.active))) continue;
+
+		if (node.count == 0)
+		{
+			assert(sp + 2 <= MAX_STACK);
+			stack[sp++] = node.first + 1;
+			stack[sp++] = node.first;
+			continue;
+		}
+		for (uint32_t i = node.first; i < node.first + node.count; i++)
+		{
+			traverseMesh(S.instances[S.bvh.prims[i]], P);
+		}
+	}
+}
+
+// calculate color (based on gouraud, and a trilinear texture sampler)
+static Color shade(Face *F, float u, float v)
+{
+	Color col;
+	col.R = F->A->LR + (F->B->LR - F->A->LR) * u + (F->C->LR - F->A->LR) * v;
+	col.G = F->A->LG + (F->B->LG - F->A->LG) * u + (F->C->LG - F->A->LG) * v;
+	col.B = F->A->LB + (F->B->LB - F->A->LB) * u + (F->C->LB - F->A->LB) * v;
 
 	// calculate lighting
 	col.R *= 1.0;
@@ -109,76 +408,132 @@ static Color raytrace(Scene *Sc, Vector *position, Vector *direction)
 	col.A = 255.0f;
 
 	// check if intersected mesh is transparent. if so, refract the ray (use raytracer again)
-	if (isect.F->Txtr->Flags & Mat_Transparent)
+	if (F->Txtr->Flags & Mat_Transparent)
 	{
 		//ref = raytrace(Sc, ..., ...);
 		//interpolate between col and ref
-	} 
+	}
 
 	// atmospheric effects: col decays based on isect.t
-	
+
 	return col;
 }
 
+static void traceRow(const SceneBVH &S, Camera *Viewer, mword j, float dx, float dy, mword gridSamples)
+{
+	const mword stochSamples = gridSamples * gridSamples;
+	const float stochScale = 1.0 / (float)stochSamples;
+	const Vec8f lane(0, 1, 2, 3, 4, 5, 6, 7);
+	Matrix &M = Viewer->Mat;
+
+	float y = (-CntrEY + (float)j) * dy;
+	dword *scanline = (dword *)((byte *)VPage + VESA_BPSL * j);
+
+	for (mword i = 0; i < XRes; i += PACKET_SIZE)
+	{
+		Vec8f x = (-CntrEX + (float)i + lane) * dx;
+		Vec8fb active = (lane + (float)i) < (float)XRes;
+
+		Vec8f R(0.0f), G(0.0f), B(0.0f);
+		for (mword k = 0; k < stochSamples; k++)
+		{
+			Vec8f tx = x + (float)(k % gridSamples) * dx / gridSamples;
+			Vec8f ty = Vec8f(y + (float)(k / gridSamples) * dy / gridSamples);
+			Vec8f il = 1.0f / sqrt(tx * tx + ty * ty + 1.0f);
+			tx *= il;
+			ty *= il;
+			Vec8f tz = il;
+
+			Packet P;
+			P.o[0] = Viewer->ISource.x;
+			P.o[1] = Viewer->ISource.y;
+			P.o[2] = Viewer->ISource.z;
+			P.d[0] = M[0][0] * tx + M[1][0] * ty + M[2][0] * tz;
+			P.d[1] = M[0][1] * tx + M[1][1] * ty + M[2][1] * tz;
+			P.d[2] = M[0][2] * tx + M[1][2] * ty + M[2][2] * tz;
+			P.active = active;
+			P.t = 1E+38f; // should calculate t based on far-Z clipping plane? maybe not.
+			P.u = 0.0f;
+			P.v = 0.0f;
+			std::fill(P.F, P.F + PACKET_SIZE, nullptr);
+
+			traverse(S, P);
+
+			float pu[PACKET_SIZE], pv[PACKET_SIZE];
+			float r[PACKET_SIZE] = { 0 }, g[PACKET_SIZE] = { 0 }, b[PACKET_SIZE] = { 0 };
+			P.u.store(pu);
+			P.v.store(pv);
+			for (int32_t l = 0; l < PACKET_SIZE; l++)
+			{
+				if (!P.F[l]) continue;
+				Color col = shade(P.F[l], pu[l], pv[l]);
+				r[l] = col.R;
+				g[l] = col.G;
+				b[l] = col.B;
+			}
+			R += Vec8f().load(r);
+			G += Vec8f().load(g);
+			B += Vec8f().load(b);
+		}
+
+		Vec8i ir = min(max(truncatei(R * stochScale), 0), 255);
+		Vec8i ig = min(max(truncatei(G * stochScale), 0), 255);
+		Vec8i ib = min(max(truncatei(B * stochScale), 0), 255);
+		dword pixels[PACKET_SIZE];
+		((ir << 16) + (ig << 8) + ib).store(pixels);
+		for (mword l = 0; l < PACKET_SIZE && i + l < XRes; l++)
+		{
+			scanline[i + l] = pixels[l];
+		}
+	}
+}
+
+} // namespace rt
+
+void GlowRaytracer_Release(Scene *Sc)
+{
+	for (TriMesh *T = Sc->TriMeshHead; T; T = T->Next)
+	{
+		rt::meshes.erase(T);
+	}
+}
+
 // stochastic raytracer that renders polygonal surfaces. Approximates volumetric glow.
 // Research log: Try to approximate integrals directly or use the alpha-hull spectrum in
 // conjunction with a rasterizing depth tracer.
 void GlowRaytracer(Scene *Sc, Camera *Viewer)
 {
-	Vector tdir, dir;
-	mword i, j, k;
-	float x, y, z = 1.0f;
 	float PX=FOVX,PY=FOVY;
-	
+
 	float dx = 1.0/PX;
 	float dy =-1.0/PY;
 
 	mword gridSamples = 2;
-	mword stochSamples = gridSamples * gridSamples;
 
-	byte *page = (byte *)VPage;
-	
+	rt::SceneBVH S;
+	S.build(Sc);
+
+	// Rows are traced in bands on the thread pool, so the director can
+	// still flip partial results every half second.
+	auto &pool = ThreadPool::instance();
+	const mword bandRows = std::max<mword>(16, pool.concurrency() * 4);
+
 	mword tthr = Timer;
-	
-	for(j=0, y=-CntrEY*dy; j<YRes; j++, y+=dy)
+
+	for(mword band = 0; band < (mword)YRes; band += bandRows)
 	{
-		dword *scanline = (dword *)(page + VESA_BPSL*j);
-		for(i=0, x=-CntrEX*dx; i<XRes; i++, x+=dx)
-		{
-			Color colorAccum;
-			colorAccum.R = 0.0;
-			colorAccum.G = 0.0;
-			colorAccum.B = 0.0;
-			for(k=0; k<stochSamples; k++)
-			{				
-//				tdir.x = x + RAND_15()*dx/32768.0;
-//				tdir.y = y + RAND_15()*dy/32768.0;
-				tdir.x = x + (float)(k%gridSamples)*dx/(gridSamples);
-				tdir.y = y + (float)(k/gridSamples)*dy/(gridSamples);
-				tdir.z = 1.0;
-				Vector_Norm(&tdir);
-
-				MatrixTXVector(Viewer->Mat, &tdir, &dir);
-				Color col = raytrace(Sc, &Viewer->ISource, &dir);
-				colorAccum.R += col.R;
-				colorAccum.G += col.G;
-				colorAccum.B += col.B;
+		mword rows = std::min<mword>(bandRows, YRes - band);
+		pool.parallel_for(rows, 1, [&](size_t begin, size_t end) {
+			for (size_t j = begin; j < end; j++)
+			{
+				rt::traceRow(S, Viewer, band + j, dx, dy, gridSamples);
 			}
+		});
 
-			float stochScale = 1.0/(float)stochSamples;
-			colorAccum.R *= stochScale;
-			colorAccum.G *= stochScale;
-			colorAccum.B *= stochScale;
-
-			dword r = colorAccum.R; if (r>255.0) r = 255.0;
-			dword g = colorAccum.G; if (g>255.0) g = 255.0;
-			dword b = colorAccum.B; if (b>255.0) b = 255.0;
-			scanline[i] = (r<<16)+(g<<8)+b;
-		}
 		if (Timer > tthr + 50)
 		{
 			tthr = Timer;
 			Flip(MainSurf);
 		}
-	}	
-}
\ No newline at end of file
+	}
+}
@@ -21,5 +21,7 @@ struct rtLocalRay
 };
 
 void GlowRaytracer(Scene *Sc, Camera *Viewer);
+// Drops the cached mesh BVHs of Sc's meshes.
+void GlowRaytracer_Release(Scene *Sc);
 
 #endif
\ No newline at end of file
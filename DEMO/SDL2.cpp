@@ -1,5 +1,6 @@
 #include <Base/FDS_VARS.H>
 #include <Base/FDS_DECS.H>
+#include <VESA/Vesa.h>
 #include <SDL.h>
 
 #ifdef __EMSCRIPTEN__
@@ -18,6 +19,26 @@ static void V_Flip(VESA_Surface *VS)
 	SDL_RenderPresent(static_cast<SDL_Renderer*>(VS->Renderer));
 }
 
+// Motion blur present: blends straight into the locked texture, so the
+// accumulated frame is read once instead of once for Modulate and again
+// for the upload.
+static void V_FlipBlend(VESA_Surface *Source, VESA_Surface *Accum, DWord PerSource, DWord PerTarget)
+{
+	auto texture = static_cast<SDL_Texture*>(Accum->Handle);
+	void *pixels;
+	int pitch;
+	if (Source->BPP != 32 || Accum->BPP != 32 || SDL_LockTexture(texture, NULL, &pixels, &pitch))
+	{
+		Modulate(Source, Accum, PerSource, PerTarget, Accum->PageSize);
+		V_Flip(Accum);
+		return;
+	}
+	AlphaBlend_Rows(Source->Data, Accum->Data, Accum->BPSL, static_cast<byte*>(pixels), pitch, Accum->Y, PerSource, PerTarget);
+	SDL_UnlockTexture(texture);
+	SDL_RenderCopy(static_cast<SDL_Renderer*>(Accum->Renderer), texture, NULL, NULL);
+	SDL_RenderPresent(static_cast<SDL_Renderer*>(Accum->Renderer));
+}
+
 static dword V_Create(VESA_Surface *VS, SDL_Renderer * renderer)
 {
 	VS->CPP = (VS->BPP+1)>>3;
@@ -66,6 +87,7 @@ dword SDL2_InitDisplay(SDL_Window *window)
 	V_Create(&SDL_MainSurf, renderer);
 
 	SDL_MainSurf.Flip = V_Flip;
+	SDL_MainSurf.FlipBlend = V_FlipBlend;
 
 	VESA_VPageExternal(&SDL_MainSurf);
 
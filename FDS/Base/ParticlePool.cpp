@@ -0,0 +1,75 @@
+#include "ParticlePool.h"
+
+#include "FDS_DEFS.H"
+#include "FDS_VARS.H"
+#include "FDS_DECS.H"
+
+#include "simde/x86/avx2.h"
+#include <simd/vectorclass.h>
+
+#include <algorithm>
+#include <cstring>
+
+void ParticlePool_Init(ParticlePool *P, DWord Capacity)
+{
+	ParticlePool_Free(P);
+
+	const DWord lanes = (Capacity + PARTICLEPOOL_LANES - 1) & ~(PARTICLEPOOL_LANES - 1);
+	const size_t stride = (sizeof(float) * lanes + PARTICLEPOOL_ALIGN - 1) & ~size_t(PARTICLEPOOL_ALIGN - 1);
+	const size_t arrays = 11;
+
+	byte *block = (byte *)getAlignedBlock(stride * arrays, PARTICLEPOOL_ALIGN);
+	memset(block, 0, stride * arrays);
+
+	float **fields[] = { &P->X, &P->Y, &P->Z, &P->VX, &P->VY, &P->VZ, &P->Life, &P->R, &P->G, &P->B };
+	for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++)
+		*fields[i] = (float *)(block + stride * i);
+	P->State = (DWord *)(block + stride * 10);
+
+	P->Block = block;
+	P->Count = 0;
+	P->Synced = 0;
+	P->Capacity = Capacity;
+}
+
+void ParticlePool_Free(ParticlePool *P)
+{
+	if (P->Block) freeAlignedBlock(P->Block);
+	*P = ParticlePool();
+}
+
+void ParticlePool_Integrate(ParticlePool *P, float dt, float Grav)
+{
+	const float dv = Grav * dt;
+	ParticlePool_ForEach8(P, [=](DWord i) {
+		Vec8f vy = Vec8f().load_a(P->VY + i) - dv;
+		vy.store_a(P->VY + i);
+		(Vec8f().load_a(P->X + i) + Vec8f().load_a(P->VX + i) * dt).store_a(P->X + i);
+		(Vec8f().load_a(P->Y + i) + vy * dt).store_a(P->Y + i);
+		(Vec8f().load_a(P->Z + i) + Vec8f().load_a(P->VZ + i) * dt).store_a(P->Z + i);
+		(Vec8f().load_a(P->Life + i) - dt).store_a(P->Life + i);
+	});
+}
+
+void ParticlePool_Sync(ParticlePool *P, Particle *Pcl, float FadeRate)
+{
+	ThreadPool::instance().parallel_for(P->Count, 1024, [=](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++)
+		{
+			Particle &p = Pcl[i];
+			p.V.Pos.x = P->X[i];
+			p.V.Pos.y = P->Y[i];
+			p.V.Pos.z = P->Z[i];
+
+			float k = FadeRate != 0.0f ? P->Life[i] * FadeRate : 1.0f;
+			p.V.LR = std::clamp(P->R[i] * k, 0.0f, 255.0f);
+			p.V.LG = std::clamp(P->G[i] * k, 0.0f, 255.0f);
+			p.V.LB = std::clamp(P->B[i] * k, 0.0f, 255.0f);
+			p.Flags = Particle_Active;
+		}
+	});
+
+	for (DWord i = P->Count; i < P->Synced; i++)
+		Pcl[i].Flags = 0;
+	P->Synced = P->Count;
+}
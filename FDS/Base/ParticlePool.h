@@ -0,0 +1,93 @@
+#ifndef REVIVAL_PARTICLEPOOL_H
+#define REVIVAL_PARTICLEPOOL_H
+
+#include "BaseDefs.h"
+#include "../Threads.h"
+
+// Structure-of-arrays particle pool.
+//
+// Live particles occupy [0, Count). Spawn appends and Kill moves the last
+// live particle into the freed slot, so both are O(1) and the live range
+// stays dense for 8-wide kinematics; particle order is not preserved.
+// Every array holds Capacity rounded up to PARTICLEPOOL_LANES entries and
+// starts on a cache line, so the last group of the live range can be
+// loaded and stored whole.
+//
+// The renderer still walks Scene::Pcl; ParticlePool_Sync mirrors the live
+// range into a slice of it every frame.
+#define PARTICLEPOOL_LANES 8
+#define PARTICLEPOOL_ALIGN 64
+
+struct Particle;
+
+struct ParticlePool
+{
+	DWord	Count		= 0;	// live particles
+	DWord	Capacity	= 0;	// maximum live particles
+	DWord	Synced		= 0;	// Count at the last ParticlePool_Sync
+
+	float	*X = nullptr, *Y = nullptr, *Z = nullptr;		// position
+	float	*VX = nullptr, *VY = nullptr, *VZ = nullptr;	// velocity
+	float	*Life = nullptr;	// counts down by dt in ParticlePool_Integrate
+	float	*R = nullptr, *G = nullptr, *B = nullptr;	// base vertex light, 0..255
+	DWord	*State = nullptr;	// owner defined bits, 0 on spawn
+
+	void	*Block = nullptr;	// single allocation backing all arrays
+};
+
+void ParticlePool_Init(ParticlePool *P, DWord Capacity);
+void ParticlePool_Free(ParticlePool *P);
+
+// Index of a fresh particle, or -1 when the pool is full.
+inline int32_t ParticlePool_Spawn(ParticlePool *P)
+{
+	if (P->Count == P->Capacity) return -1;
+	DWord i = P->Count++;
+	P->State[i] = 0;
+	return i;
+}
+
+// Moves the last live particle into slot i.
+inline void ParticlePool_Kill(ParticlePool *P, DWord i)
+{
+	DWord last = --P->Count;
+	P->X[i] = P->X[last]; P->Y[i] = P->Y[last]; P->Z[i] = P->Z[last];
+	P->VX[i] = P->VX[last]; P->VY[i] = P->VY[last]; P->VZ[i] = P->VZ[last];
+	P->Life[i] = P->Life[last];
+	P->R[i] = P->R[last]; P->G[i] = P->G[last]; P->B[i] = P->B[last];
+	P->State[i] = P->State[last];
+}
+
+// Kills every live particle for which Dead(i) holds.
+template <typename F>
+void ParticlePool_Compact(ParticlePool *P, F &&Dead)
+{
+	for (DWord i = 0; i < P->Count;)
+	{
+		if (Dead(i)) ParticlePool_Kill(P, i);
+		else i++;
+	}
+}
+
+// Calls f(i) for i = 0, 8, 16... over the live range, groups spread across
+// the thread pool. Lanes past Count are padding: f may compute on them but
+// their values mean nothing.
+template <typename F>
+void ParticlePool_ForEach8(ParticlePool *P, F &&f)
+{
+	const size_t groups = (P->Count + PARTICLEPOOL_LANES - 1) / PARTICLEPOOL_LANES;
+	ThreadPool::instance().parallel_for(groups, 256, [&](size_t begin, size_t end) {
+		for (size_t g = begin; g < end; g++)
+			f(DWord(g * PARTICLEPOOL_LANES));
+	});
+}
+
+// Ballistic step: V.y -= Grav*dt, Pos += V*dt, Life -= dt.
+void ParticlePool_Integrate(ParticlePool *P, float dt, float Grav);
+
+// Mirrors the live range into Pcl[0, Count): position, vertex light and
+// Particle_Active; slots that died since the last sync are deactivated.
+// With FadeRate != 0 the light is scaled by Life*FadeRate.
+void ParticlePool_Sync(ParticlePool *P, Particle *Pcl, float FadeRate = 0.0f);
+
+#endif //REVIVAL_PARTICLEPOOL_H
@@ -46,7 +46,11 @@ struct Scene
     dword			 SBufferCur;
     dword			 SBufferSize;
     sdword			*SBufferHead;
-    dword			 NumTiles;
+    dword			 NumTiles;			// TBR tiles, TBRTilesX per row
+    dword			 TBRTilesX;
+    dword			 TBRTileLog;		// log2 of the TBR tile edge, in pixels
+
+    uint64_t         FileHash;			// hash of the scene file (set by LoadFLD, 0 otherwise); keys on-disk caches
 };
 
 #pragma pack(pop)
@@ -37,7 +37,7 @@ struct SplineKey
 // Total: [16 Bytes+88 Bytes per Key]
 struct Spline
 {
-	DWord NumKeys = 0,CurKey = 0;
+	DWord NumKeys = 0,CurKey = 0; // CurKey: write cursor for Spline_SetKey_*, not used by evaluation
 	SplineKey *Keys				= nullptr;
 	DWord Flags					= 0;
 	void print() {
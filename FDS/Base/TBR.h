@@ -7,10 +7,14 @@
 #pragma pack(push, 1)
 
 // entry for TBR - implements multiple lists of entries over a vector.
+// Holds either a sprite (F->A == F->B) or a transparent face.
 struct TBREntry
 {
     Face *F;
     dword next;
+    float Z;        // view space depth, entries are composited back to front
+    dword Poly;     // faces: first vertex of the screen-clipped polygon
+    dword NumVerts; // faces: its vertex count
 };
 
 #pragma pack(pop)
@@ -29,6 +29,7 @@ struct Texture
 
     dword ID                = 0;
     dword Flags             = 0;
+    dword Format            = 0; // TEXTURE_FORMAT; lets Load_Texture skip format probing.
 };
 
 #pragma pack(pop)
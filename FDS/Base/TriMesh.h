@@ -21,6 +21,7 @@ struct TriMesh
     // uses packed dword BGRA to reduce memory read bandwidth usage
     // was optimized out for sse benefit
     Color			*SL             = nullptr;
+    uint64_t         SLKey          = 0;     //Hash of the inputs SL was baked from, 0 = not baked
     DWord            VIndex         = 0;     //Amount of Vertices on Mesh
     DWord            FIndex         = 0;     //Amount of Faces on Mesh
     DWord            EIndex         = 0;     //Amount of Edges on Mesh
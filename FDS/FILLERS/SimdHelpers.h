@@ -21,6 +21,15 @@ inline Vec8i packed_tile_u(Vec8i& u, int32_t vbits, uint32_t swizzled_umask) {
 	return (u & 3) | ((u << vbits) & swizzled_umask);
 }
 
+// Per-lane variants, for sampling a different mip level in every lane.
+inline Vec8i packed_tile_v(Vec8i v, Vec8i vmask) {
+	return (v & vmask) << 2;
+}
+
+inline Vec8i packed_tile_u(Vec8i u, Vec8i vbits, Vec8i swizzled_umask) {
+	return (u & 3) | (Vec8i(_mm256_sllv_epi32(u, vbits)) & swizzled_umask);
+}
+
 
 template <typename T>
 struct v8_trait {};
@@ -116,6 +125,20 @@ inline Vec32uc colorize(Vec32uc color1, Vec32us color2) {
 	return compress((extend(color1) * (color2 >> Shift)) >> 8);
 }
 
+// Spreads a per-pixel weight (0..256) over the pixel's four 16-bit channel
+// lanes, matching the layout of extend(Vec32uc).
+inline Vec32us expand_weight(Vec8i w) {
+	Vec8i w2 = w | (w << 16);
+	return Vec32us(Vec16us(permute8<0, 0, 1, 1, 2, 2, 3, 3>(w2)), Vec16us(permute8<4, 4, 5, 5, 6, 6, 7, 7>(w2)));
+}
+
+// Per-channel a + (b - a) * w / 256 on 8 packed 8888 texels.
+inline Vec8ui lerp_texels(Vec8ui a, Vec8ui b, Vec32us w) {
+	Vec32us ea = extend(Vec32uc(a));
+	Vec32us eb = extend(Vec32uc(b));
+	return Vec8ui(compress((ea * (Vec32us(256) - w) + eb * w) >> 8));
+}
+
 inline Vec8ui gather(const Vec8ui index, void const* table, Vec8ib mask) {
 #if INSTRSET >= 8
 	return (_mm256_mask_i32gather_epi32(Vec8ui(0), (const int *)table, static_cast<__m256i>(index), *(__m256i *)(&mask)/*static_cast<__m256i>(mask)*/, 4));
@@ -78,6 +78,16 @@ enum class TTextureMode {
 	TEXTURETEXTURE,
 };
 
+// Sampling of the base texture. POINT and BILINEAR use the mip level picked
+// per (sub)polygon by FrustumClipper::MiplevelClipper; TRILINEAR derives
+// the LOD per pixel from the UV derivatives, so the clipper doesn't split
+// the polygon (see Face_PixelLOD).
+enum class TFilterMode {
+	POINT,
+	BILINEAR,
+	TRILINEAR,
+};
+
 inline TScreenCoord orient2d(
 	TScreenCoord ax, TScreenCoord ay,
 	TScreenCoord bx, TScreenCoord by,
@@ -117,6 +127,25 @@ inline bool any_lane_set(Vec8ib m) {
 #endif
 }
 
+inline uint16_t horizontal_min(Vec8us a) {
+	return uint16_t(_mm_extract_epi16(_mm_minpos_epu16(a), 0));
+}
+
+// Hierarchical Z: one entry per 8x8 tile holding a lower bound of the
+// encoded Z values stored in that tile (i.e. its farthest pixel). Since
+// encoded Z only ever grows while a frame is drawn, any value read back
+// stays a valid bound. Render() points this at its buffer for the duration
+// of the tile jobs; tiles == nullptr disables the test.
+struct HiZBuffer {
+	uint16_t* tiles = nullptr;
+	int32_t pitch = 0;
+};
+inline HiZBuffer g_hiz;
+
+// approx_recipr() is good to ~11 bits, so the rasterizer's Z can come out
+// this much nearer than the exact 1/rz. Rejection must allow for it.
+constexpr const float HIZ_RECIPR_SLACK = 1.0f - 1.0f / 1024.0f;
+
 // block-tiling adjustment functions
 // Example for 256x256 texture
 //    3         2         1         0
@@ -148,7 +177,7 @@ inline uint32_t tile_du(uint32_t u, uint32_t vbits, uint32_t umask) {
 	return tile_u(u, vbits, umask) | 0x800 | (((1 << vbits) - 1) << 14);
 }
 
-template <barry::TBlendMode BlendMode, barry::TTextureMode TextureMode>
+template <barry::TBlendMode BlendMode, barry::TTextureMode TextureMode, barry::TFilterMode FilterMode = barry::TFilterMode::POINT>
 struct TileRasterizer {
 	TileRasterizer(Vertex** V, byte* dstSurface, int32_t bpsl, int32_t xres, int32_t yres, Texture* Txtr, int miplevel)
 		: V(V)
@@ -157,6 +186,20 @@ struct TileRasterizer {
 		, xres(xres)
 		, yres(yres) {
 
+		if constexpr (FilterMode == TFilterMode::TRILINEAR) {
+			// levels are chosen per pixel, relative to level 0
+			miplevel = 0;
+			mip.maxLevel = std::max<int32_t>(Txtr->numMipmaps, 1) - 1;
+			for (int32_t l = 0; l <= mip.maxLevel; ++l) {
+				const int32_t logWidth = Txtr->LSizeX - l;
+				const int32_t logHeight = Txtr->LSizeY - l;
+				mip.offset[l] = int32_t((Txtr->Mipmap[l] - Txtr->Mipmap[0]) / sizeof(dword));
+				mip.vbits[l] = logHeight;
+				mip.umask[l] = swizzle_umask(logHeight, (1 << logWidth) - 1);
+				mip.vmask[l] = (1 << logHeight) - 1;
+			}
+		}
+
 		t0.LogWidth = Txtr->LSizeX - miplevel;
 		t0.LogHeight = Txtr->LSizeY - miplevel;
 		t0.TextureAddr = (dword*)Txtr->Mipmap[miplevel];
@@ -191,6 +234,17 @@ struct TileRasterizer {
 	uint32_t umask;// = (1 << t0.LogWidth) - 1);
 	uint32_t vmask;// = (1 << t0.LogHeight) - 1);
 	TextureInfo t0;
+
+	// TRILINEAR only: addressing for every mip level, offsets in dwords
+	// from level 0 (Generate_Mipmaps keeps the chain in one block).
+	struct MipTable {
+		alignas(32) int32_t offset[16] = {};
+		alignas(32) int32_t vbits[16] = {};
+		alignas(32) int32_t umask[16] = {};
+		alignas(32) int32_t vmask[16] = {};
+		int32_t maxLevel = 0;
+	};
+	MipTable mip;
 	//size_t v1 = 0 , v2 = 0, v3 = 0;
 	//void setVertexIndexes(size_t v1, size_t v2, size_t v3) {
 	//	this->v1 = v1;
@@ -209,7 +263,92 @@ struct TileRasterizer {
 		return int16_t(f);
 	}
 
+	// Four-tap fetch around texel coordinates given in 24.8 fixed point.
+	// Addressing may differ per lane (mip level), hence the vector args.
+	// Texel centers sit at +0.5, so the coordinate is pulled back half a
+	// texel before it is split into index and weight; this is done after
+	// the per-level shift, so it holds on every mip level.
+	Vec8ui fetch_bilinear(Vec8i uf, Vec8i vf, Vec8i vbits, Vec8i umask_swizzled, Vec8i vmask, Vec8i base, Vec8ib p_mask) {
+		uf -= 128;
+		vf -= 128;
+		Vec8i u0 = uf >> 8;
+		Vec8i v0 = vf >> 8;
+		Vec8i tu0 = packed_tile_u(u0, vbits, umask_swizzled) + base;
+		Vec8i tu1 = packed_tile_u(u0 + 1, vbits, umask_swizzled) + base;
+		Vec8i tv0 = packed_tile_v(v0, vmask);
+		Vec8i tv1 = packed_tile_v(v0 + 1, vmask);
+
+		auto s00 = gather(Vec8ui(tu0 + tv0), t0.TextureAddr, p_mask);
+		auto s10 = gather(Vec8ui(tu1 + tv0), t0.TextureAddr, p_mask);
+		auto s01 = gather(Vec8ui(tu0 + tv1), t0.TextureAddr, p_mask);
+		auto s11 = gather(Vec8ui(tu1 + tv1), t0.TextureAddr, p_mask);
+
+		auto wu = expand_weight(uf & 0xFF);
+		auto top = lerp_texels(s00, s10, wu);
+		auto bottom = lerp_texels(s01, s11, wu);
+		return lerp_texels(top, bottom, expand_weight(vf & 0xFF));
+	}
+
+	Vec8ui sample_t0(Vec8f p_uz, Vec8f p_vz, Vec8f p_z, Vec8ib p_mask, int32_t umask_swizzled, int32_t vmask) {
+		if constexpr (FilterMode == TFilterMode::POINT) {
+			Vec8i u = roundi(p_uz * p_z * t0.UScaleFactor);
+			Vec8i v = roundi(p_vz * p_z * t0.VScaleFactor);
+
+			Vec8i tu = packed_tile_u(u, t0.LogHeight, umask_swizzled);
+			Vec8i tv = packed_tile_v(v, vmask);
+
+			return gather(Vec8ui(tu + tv), t0.TextureAddr, p_mask);
+		} else if constexpr (FilterMode == TFilterMode::BILINEAR) {
+			Vec8i uf = roundi(p_uz * p_z * (t0.UScaleFactor * 256.0f));
+			Vec8i vf = roundi(p_vz * p_z * (t0.VScaleFactor * 256.0f));
+			return fetch_bilinear(uf, vf, Vec8i(t0.LogHeight), Vec8i(umask_swizzled), Vec8i(vmask), Vec8i(0), p_mask);
+		} else {
+			Vec8f u = p_uz * p_z;
+			Vec8f v = p_vz * p_z;
+
+			// d(uz/rz) = (duz - u * drz) / rz, scaled to level 0 texels
+			Vec8f dudx = (Vec8f(t0.du0zdx) - u * drzdx) * p_z * t0.UScaleFactor;
+			Vec8f dvdx = (Vec8f(t0.dv0zdx) - v * drzdx) * p_z * t0.VScaleFactor;
+			Vec8f dudy = (Vec8f(t0.du0zdy) - u * drzdy) * p_z * t0.UScaleFactor;
+			Vec8f dvdy = (Vec8f(t0.dv0zdy) - v * drzdy) * p_z * t0.VScaleFactor;
+			Vec8f rho2 = max(dudx * dudx + dvdx * dvdx, dudy * dudy + dvdy * dvdy);
+
+			// lod = log2(rho); log2 taken piecewise linear from the float's
+			// exponent and mantissa, which is plenty for a blend weight.
+			Vec8f lod = 0.5f * (to_float(exponent(rho2)) + fraction(rho2) - 1.0f);
+			lod = min(max(lod, Vec8f(0.0f)), Vec8f(float(mip.maxLevel)));
+			Vec8i level0 = min(max(truncatei(lod), Vec8i(0)), Vec8i(mip.maxLevel));
+			Vec8i level1 = min(level0 + 1, Vec8i(mip.maxLevel));
+			Vec8i w = roundi((lod - to_float(level0)) * 256.0f);
+
+			Vec8i uf = roundi(u * (t0.UScaleFactor * 256.0f));
+			Vec8i vf = roundi(v * (t0.VScaleFactor * 256.0f));
+
+			auto s0 = fetch_bilinear(
+				Vec8i(_mm256_srav_epi32(uf, level0)), Vec8i(_mm256_srav_epi32(vf, level0)),
+				lookup<16>(level0, mip.vbits), lookup<16>(level0, mip.umask), lookup<16>(level0, mip.vmask), lookup<16>(level0, mip.offset),
+				p_mask);
+			auto s1 = fetch_bilinear(
+				Vec8i(_mm256_srav_epi32(uf, level1)), Vec8i(_mm256_srav_epi32(vf, level1)),
+				lookup<16>(level1, mip.vbits), lookup<16>(level1, mip.umask), lookup<16>(level1, mip.vmask), lookup<16>(level1, mip.offset),
+				p_mask);
+			return lerp_texels(s0, s1, expand_weight(w));
+		}
+	}
+
+	// Tile partially covered by the triangle: per-pixel edge tests.
 	void apply_exact(const barry::Tile& tile) {
+		apply<false>(tile);
+	}
+
+	// Tile entirely inside the triangle: skips edge evaluation, only Z test,
+	// texture fetch and store remain.
+	void apply_full(const barry::Tile& tile) {
+		apply<true>(tile);
+	}
+
+	template <bool FullyCovered>
+	void apply(const barry::Tile& tile) {
 		auto scanline = dstSurface + tile.y * TILE_SIZE * bpsl;
 		auto zscanline = dstSurface + PageSize + tile.y * TILE_SIZE * XRes * 2;
 		auto span = ((uint32_t*)scanline) + tile.x * TILE_SIZE;
@@ -253,9 +392,16 @@ struct TileRasterizer {
 			{ FixedPoint(tile.t0.r0), FixedPoint(tile.t0.g0), FixedPoint(tile.t0.b0), FixedPoint(tile.t0.a0) },
 			{ FixedPoint(drdx),	   FixedPoint(dgdx),		FixedPoint(dbdx),		 FixedPoint(dadx) });
 
+		bool wrote = false;
+
 		//Vec16s rg
 		for (int32_t y = 0; y != TILE_SIZE; ++y, a0 += tile.dady, b0 += tile.dbdy, c0 += tile.dcdy, span += bpsl_u32, zspan += XRes) {
-			auto p_mask = (p_a | p_b | p_c) >= 0;
+			Vec8ib p_mask;
+			if constexpr (FullyCovered) {
+				p_mask = Vec8ib(true);
+			} else {
+				p_mask = (p_a | p_b | p_c) >= 0;
+			}
 			// horizontal_or(Vec8ib) compiles to !_mm256_testz_si256(a,a).
 			// simde's wasm impl of testz misses some cases where only the
 			// low lane has bits set (we observed lane 0 = 0xFFFFFFFF +
@@ -264,7 +410,7 @@ struct TileRasterizer {
 			// inside the triangle. _mm256_movemask_epi8 routes through a
 			// different simde primitive that handles this correctly on
 			// every target.
-			if (any_lane_set(p_mask)) {
+			if (FullyCovered || any_lane_set(p_mask)) {
 				Vec8f p_z = approx_recipr(p_rz);
 
 				auto z_candidate = (Vec8ui(0xFF80) - static_cast<Vec8ui>(roundi(g_zscale * p_z)));
@@ -277,22 +423,15 @@ struct TileRasterizer {
 				p_mask &= zmask;
 
 				if (any_lane_set(p_mask)) {
+					wrote = true;
 
 //					if constexpr (BlendMode != TBlendMode::TRANSPARENT) {
 						*(__m128i*)zspan = _mm_blendv_epi8(*(__m128i*)zspan, compress(z_candidate), compress(Vec8ui(p_mask)));
 					//}
 
-					Vec8i u = roundi(p_uz * p_z * t0.UScaleFactor);
-					Vec8i v = roundi(p_vz * p_z * t0.VScaleFactor);
-
-					Vec8i tu = packed_tile_u(u, t0.LogHeight, t0_umask_swizzled);
-					Vec8i tv = packed_tile_v(v, t0_vmask);
-
-					auto p_offset = tu + tv;
-
 					auto blend_color = Vec32us(color);
 
-					auto texture0_samples = gather(Vec8ui(p_offset), t0.TextureAddr, p_mask);
+					auto texture0_samples = sample_t0(p_uz, p_vz, p_z, p_mask, t0_umask_swizzled, t0_vmask);
 					if constexpr (TextureMode == barry::TTextureMode::TEXTURETEXTURE) {
 						Vec8i u1 = roundi(p_u1z * p_z * 1024.0f);
 						Vec8i v1 = roundi(p_v1z * p_z * 1024.0f);
@@ -333,12 +472,32 @@ struct TileRasterizer {
 			}
 			color += Vec32sFromVec4s({ FixedPoint(drdy), FixedPoint(dgdy), FixedPoint(dbdy), FixedPoint(dady) });
 
-			p_a += Vec8i(tile.dady);
-			p_b += Vec8i(tile.dbdy);
-			p_c += Vec8i(tile.dcdy);
+			if constexpr (!FullyCovered) {
+				p_a += Vec8i(tile.dady);
+				p_b += Vec8i(tile.dbdy);
+				p_c += Vec8i(tile.dcdy);
+			}
+		}
+
+		if (g_hiz.tiles && wrote) {
+			update_hiz(tile);
 		}
 	}
 
+	// Refresh the tile's HiZ entry from the Z rows just written.
+	void update_hiz(const barry::Tile& tile) {
+		const int32_t rows = std::min(TILE_SIZE, yres - tile.y * TILE_SIZE);
+		auto zrow = ((uint16_t*)(dstSurface + PageSize)) + tile.y * TILE_SIZE * XRes + tile.x * TILE_SIZE;
+		Vec8us zmin;
+		zmin.load_a(zrow);
+		for (int32_t y = 1; y < rows; ++y) {
+			Vec8us z;
+			z.load_a(zrow + y * XRes);
+			zmin = min(zmin, z);
+		}
+		g_hiz.tiles[tile.y * g_hiz.pitch + tile.x] = horizontal_min(zmin);
+	}
+
 	
 	void rasterize_triangle(const Vertex& v1, const Vertex& v2, const Vertex& v3) {
 		// FIXME: raster conventions (it is doing floor right now)
@@ -392,6 +551,13 @@ struct TileRasterizer {
 			// this is constant across entire triangle
 		int i = 0;
 		float zoltek = 1.0f / (_a0 + _b0 + _c0);
+
+		// HiZ setup: the nearest 1/z the triangle can reach inside a tile is
+		// at the tile corner the rz gradient points to, capped by the
+		// nearest vertex.
+		const uint16_t* hiz = g_hiz.tiles;
+		const float max_vertex_rz = std::max({ v1.RZ, v2.RZ, v3.RZ });
+		const float rz_span = std::max(0.0f, drzdx * (TILE_SIZE - 1)) + std::max(0.0f, drzdy * (TILE_SIZE - 1));
 		for (int y = tile_my; y <= tile_My; ++y, _a0 += TILE_SIZE * dady, _b0 += TILE_SIZE * dbdy, _c0 += TILE_SIZE * dcdy, ++i) {
 			TScreenCoord a0 = _a0;
 			TScreenCoord b0 = _b0;
@@ -400,8 +566,19 @@ struct TileRasterizer {
 				TScreenCoord max_a = a0 + ((dadx > 0) ? dadx * TILE_SIZE : 0) + ((dady > 0) ? dady * TILE_SIZE : 0);
 				TScreenCoord max_b = b0 + ((dbdx > 0) ? dbdx * TILE_SIZE : 0) + ((dbdy > 0) ? dbdy * TILE_SIZE : 0);
 				TScreenCoord max_c = c0 + ((dcdx > 0) ? dcdx * TILE_SIZE : 0) + ((dcdy > 0) ? dcdy * TILE_SIZE : 0);
+				TScreenCoord min_a = a0 + ((dadx < 0) ? dadx * TILE_SIZE : 0) + ((dady < 0) ? dady * TILE_SIZE : 0);
+				TScreenCoord min_b = b0 + ((dbdx < 0) ? dbdx * TILE_SIZE : 0) + ((dbdy < 0) ? dbdy * TILE_SIZE : 0);
+				TScreenCoord min_c = c0 + ((dcdx < 0) ? dcdx * TILE_SIZE : 0) + ((dcdy < 0) ? dcdy * TILE_SIZE : 0);
 
 				if ((max_a | max_b | max_c) >= 0) {
+					// Early out: nothing in this tile can pass the Z test.
+					if (hiz) {
+						const float tile_rz = std::min(max_vertex_rz, v1.RZ + (x * TILE_SIZE - v1.PX) * drzdx + (y * TILE_SIZE - v1.PY) * drzdy + rz_span);
+						if (tile_rz > 0.0f && float(0xFF80) - HIZ_RECIPR_SLACK * g_zscale / tile_rz + 1.0f <= float(hiz[y * g_hiz.pitch + x])) {
+							continue;
+						}
+					}
+
 					// FIXME: define outside and maintain
 					Tile tile = {
 						.x = x,
@@ -434,7 +611,11 @@ struct TileRasterizer {
 						tile.t0.vz1 = (v1.EVZ + (x * TILE_SIZE - v1.PX) * t0.dv1zdx + (y * TILE_SIZE - v1.PY) * t0.dv1zdy);
 					}
 
-					apply_exact(tile);
+					if ((min_a | min_b | min_c) >= 0) {
+						apply_full(tile);
+					} else {
+						apply_exact(tile);
+					}
 				}
 			}
 		}
@@ -444,14 +625,14 @@ struct TileRasterizer {
 
 } // namespace barry
 
-template <barry::TBlendMode BlendMode, barry::TTextureMode TextureMode = barry::TTextureMode::NORMAL>
+template <barry::TBlendMode BlendMode, barry::TTextureMode TextureMode = barry::TTextureMode::NORMAL, barry::TFilterMode FilterMode = barry::TFilterMode::POINT>
 void TheOtherBarry(Face* F, Vertex** V, dword numVerts, dword miplevel) {
 	//for (dword i = 0; i < numVerts; ++i) {
 	//	float z = 1.0f / V[i]->RZ;
 	//	V[i]->U = V[i]->UZ * z;
 	//	V[i]->V = V[i]->VZ * z;
 	//}
-	barry::TileRasterizer<BlendMode, TextureMode> r(V, VPage, VESA_BPSL, XRes, YRes, F->Txtr->Txtr, miplevel);
+	barry::TileRasterizer<BlendMode, TextureMode, FilterMode> r(V, VPage, VESA_BPSL, XRes, YRes, F->Txtr->Txtr, miplevel);
 
 	if constexpr (TextureMode == barry::TTextureMode::TEXTURETEXTURE) {
 		r.t0.TextureAddr1 = (dword*)F->ReflectionTexture->Data;
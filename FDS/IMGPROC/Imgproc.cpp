@@ -4,6 +4,7 @@
 #include <stdlib.h>
 #include <memory.h>
 #include <string.h>
+#include <algorithm>
 //#include <conio.h>
 
 #include "Base/FDS_VARS.H"
@@ -107,55 +108,161 @@ void Make_Modulation()
 //	delete Img.Data;
 //}
 
-// Mip-maps a given Image by simple Texel averaging
-void MipmapXY(Image *Img)
+namespace mipns {
+	// Linear light values are quantized to this many steps on the way back
+	// to sRGB; 4096 keeps every dark sRGB code distinct.
+	constexpr int32_t LIN_STEPS = 4096;
+	constexpr int32_t KAISER_TAPS = 6;
+
+	struct MipTables {
+		// [0..255]: byte/255, [256..511]: sRGB decode of byte.
+		float ToLinear[512];
+		// sRGB encode of i/(LIN_STEPS-1).
+		int32_t FromLinear[LIN_STEPS];
+		// 2:1 Kaiser-windowed sinc (radius 3, alpha 4) at source texels
+		// 2X-2..2X+3, normalized.
+		float Kaiser[KAISER_TAPS];
+
+		MipTables()
+		{
+			for (int32_t i = 0; i < 256; i++)
+			{
+				float c = i / 255.0f;
+				ToLinear[i] = c;
+				ToLinear[256 + i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+			}
+			for (int32_t i = 0; i < LIN_STEPS; i++)
+			{
+				float l = i / float(LIN_STEPS - 1);
+				float c = l <= 0.0031308f ? l * 12.92f : 1.055f * powf(l, 1.0f / 2.4f) - 0.055f;
+				FromLinear[i] = int32_t(c * 255.0f + 0.5f);
+			}
+			auto I0 = [](double x) {
+				double sum = 1.0, term = 1.0;
+				for (int32_t k = 1; k < 32; k++)
+				{
+					term *= (x * 0.5 / k) * (x * 0.5 / k);
+					sum += term;
+				}
+				return sum;
+			};
+			const double alpha = 4.0, radius = 3.0;
+			double total = 0.0, w[KAISER_TAPS];
+			for (int32_t t = 0; t < KAISER_TAPS; t++)
+			{
+				double d = t - 2.5;
+				double x = PI * d * 0.5;
+				double r = d / radius;
+				w[t] = (sin(x) / x) * I0(alpha * sqrt(1.0 - r * r)) / I0(alpha);
+				total += w[t];
+			}
+			for (int32_t t = 0; t < KAISER_TAPS; t++)
+				Kaiser[t] = float(w[t] / total);
+		}
+	};
+
+	static const MipTables &Tables()
+	{
+		static const MipTables T;
+		return T;
+	}
+
+	// Source texel index for tap position i: wraps on power of 2 sizes
+	// (textures tile), clamps otherwise.
+	static inline int32_t Address(int32_t i, int32_t n)
+	{
+		if (!(n & (n - 1))) return i & (n - 1);
+		return i < 0 ? 0 : (i >= n ? n - 1 : i);
+	}
+}
+
+// Halves a given Image in both directions. The 2:1 filter is a box or a
+// Kaiser-windowed sinc (Filter = MipFilter_Box/MipFilter_Kaiser); with
+// Linear set, colour is filtered in linear light (sRGB->linear->sRGB via
+// tables) so dark detail doesn't sink in distant mips. Alpha is always
+// filtered as is. Odd sizes round up, repeating the edge texel.
+void MipmapXY(Image *Img, dword Filter, mword Linear)
 {
-	int32_t X,Y;
-	dword *Mip = new dword[((Img->x+1)>>1)*((Img->y+1)>>1)];
-	byte *Trg = (byte *)Mip;
-	byte *Src = (byte *)Img->Data;
-	byte  *Tex;
-	int32_t X4 = Img->x<<2,Y4 = Img->y<<2;
-	int32_t X4_4 = X4+4;
-	
-	for(Y=0;Y<Img->y>>1;Y++)
+	using namespace mipns;
+	const MipTables &T = Tables();
+	const int32_t SX = Img->x, SY = Img->y;
+	const int32_t DX = (SX + 1) >> 1, DY = (SY + 1) >> 1;
+
+	static const float Box[2] = { 0.5f, 0.5f };
+	const float *W = Filter == MipFilter_Kaiser ? T.Kaiser : Box;
+	const int32_t Taps = Filter == MipFilter_Kaiser ? KAISER_TAPS : 2;
+	const int32_t First = Filter == MipFilter_Kaiser ? -2 : 0;
+
+	// bytes -> floats (linear light for colour if asked), 2 texels per op
+	const int32_t N = SX * SY * 4;
+	float *Lin = (float *)getAlignedBlock(N * sizeof(float));
+	const byte *Src = (const byte *)Img->Data;
+	const Vec8i Table = Linear ? Vec8i(256, 256, 256, 0, 256, 256, 256, 0) : Vec8i(0);
+	int32_t i = 0;
+	for (; i + 8 <= N; i += 8)
 	{
-		for(X=0;X<Img->x>>1;X++)
+		Vec8i b = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(Src + i)));
+		lookup<512>(b + Table, T.ToLinear).store(Lin + i);
+	}
+	for (; i < N; i++)
+		Lin[i] = T.ToLinear[Src[i] + ((Linear && (i & 3) != 3) ? 256 : 0)];
+
+	// horizontal pass: SY rows of DX texels
+	const int32_t HPitch = DX * 4;
+	float *H = (float *)getAlignedBlock(SY * HPitch * sizeof(float));
+	for (int32_t y = 0; y < SY; y++)
+	{
+		const float *Row = Lin + y * SX * 4;
+		float *Out = H + y * HPitch;
+		int32_t x = 0;
+		for (; x + 2 <= DX; x += 2)
 		{
-			Tex = Src+((X+Y*Img->x)<<3);
-			*Trg++ = ((*Tex)+(*(Tex+4))+(*(Tex+X4))+(*(Tex+X4_4)))>>2; Tex++;
-			*Trg++ = ((*Tex)+(*(Tex+4))+(*(Tex+X4))+(*(Tex+X4_4)))>>2; Tex++;
-			*Trg++ = ((*Tex)+(*(Tex+4))+(*(Tex+X4))+(*(Tex+X4_4)))>>2; Tex++;
-			*Trg++ = ((*Tex)+(*(Tex+4))+(*(Tex+X4))+(*(Tex+X4_4)))>>2; Tex++;
+			Vec8f acc(0.0f);
+			for (int32_t t = 0; t < Taps; t++)
+			{
+				int32_t a = Address(2 * x + First + t, SX);
+				int32_t b = Address(2 * x + 2 + First + t, SX);
+				acc = mul_add(Vec8f(Vec4f().load(Row + a * 4), Vec4f().load(Row + b * 4)), W[t], acc);
+			}
+			acc.store(Out + x * 4);
 		}
-		// copy last texel as a two-texel average
-		if (Img->x&1)
+		if (x < DX)
 		{
-			Tex = Src+(X4-4+Y*X4);
-			*Trg++ = ((*Tex)+(*(Tex+X4)))>>1; Tex++;
-			*Trg++ = ((*Tex)+(*(Tex+X4)))>>1; Tex++;
-			*Trg++ = ((*Tex)+(*(Tex+X4)))>>1; Tex++;
-			*Trg++ = ((*Tex)+(*(Tex+X4)))>>1; Tex++;
+			Vec4f acc(0.0f);
+			for (int32_t t = 0; t < Taps; t++)
+				acc = mul_add(Vec4f().load(Row + Address(2 * x + First + t, SX) * 4), W[t], acc);
+			acc.store(Out + x * 4);
 		}
 	}
-	if (Img->y&1)
+	freeAlignedBlock(Lin);
+
+	// vertical pass straight into the output texels
+	dword *Mip = new dword[DX * DY];
+	byte *Trg = (byte *)Mip;
+	const Vec8ib AlphaLane = Vec8i(0, 0, 0, -1, 0, 0, 0, -1) != 0;
+	for (int32_t y = 0; y < DY; y++)
 	{
-		Y = Img->y-1;
-		// copy last row as two-texel average
-		for(X=0;X<Img->x>>1;X++)
+		for (int32_t x = 0; x < HPitch; x += 8)
 		{
-			Tex = Src+((X+Y*Img->x)<<2);
-			*Trg++ = ((*Tex)+(*(Tex+4)))>>1; Tex++;
-			*Trg++ = ((*Tex)+(*(Tex+4)))>>1; Tex++;
-			*Trg++ = ((*Tex)+(*(Tex+4)))>>1; Tex++;
-			*Trg++ = ((*Tex)+(*(Tex+4)))>>1; Tex++;
+			const int32_t n = std::min(8, HPitch - x);
+			Vec8f acc(0.0f);
+			for (int32_t t = 0; t < Taps; t++)
+				acc = mul_add(Vec8f().load_partial(n, H + Address(2 * y + First + t, SY) * HPitch + x), W[t], acc);
+			acc = min(max(acc, 0.0f), 1.0f);
+
+			Vec8i c = truncatei(acc * 255.0f + 0.5f);
+			if (Linear)
+				c = select(AlphaLane, c, lookup<LIN_STEPS>(truncatei(acc * float(LIN_STEPS - 1) + 0.5f), T.FromLinear));
+			Vec8s words = compress_saturated(c.get_low(), c.get_high());
+			Vec16uc packed = _mm_packus_epi16(words, words);
+			packed.store_partial(n, Trg + y * HPitch + x);
 		}
-		if (Img->x&1) // copy last texel as it is
-			*((dword *)Trg) = *((dword *)Tex);
 	}
+	freeAlignedBlock(H);
+
 	free(Img->Data);
-	Img->x = (Img->x+1)>>1;
-	Img->y = (Img->y+1)>>1;
+	Img->x = DX;
+	Img->y = DY;
 	Img->Data = Mip;
 }
 
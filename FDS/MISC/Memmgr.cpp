@@ -2,10 +2,26 @@
 #include "Base/FDS_VARS.H"
 #include "Base/FDS_DECS.H"
 
+#include <stdio.h>
 #include <map>
+#include <mutex>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 using namespace std;
 map<uintptr_t, uintptr_t> g_AlignedBlockMap;
+// textures and mipmaps are allocated from pool jobs
+static mutex g_AlignedBlockLock;
 
 void *getAlignedBlock(uintptr_t size, uintptr_t alignment)
 {
@@ -13,6 +29,7 @@ void *getAlignedBlock(uintptr_t size, uintptr_t alignment)
 	uintptr_t aligned = (addr + alignment-1)&(~(alignment-1));
 	
 	//g_AlignedBlockMap.insert(pair<mword, mword> ();
+	lock_guard<mutex> lock(g_AlignedBlockLock);
 	g_AlignedBlockMap[aligned] = addr;
 	return (void *)aligned;
 }
@@ -20,6 +37,7 @@ void *getAlignedBlock(uintptr_t size, uintptr_t alignment)
 void freeAlignedBlock(void *ptr)
 {
 	uintptr_t aligned = (uintptr_t)ptr;
+	unique_lock<mutex> lock(g_AlignedBlockLock);
 	bool exists = g_AlignedBlockMap.find(aligned) != g_AlignedBlockMap.end();
 	uintptr_t addr;
 	if (exists)
@@ -28,8 +46,68 @@ void freeAlignedBlock(void *ptr)
 	} else {
 		addr = aligned;
 	}
+	lock.unlock();
 
 	if (!addr) return;
 	free((void *)addr);
 }
 
+// Hash_Bytes of a whole file.
+bool Hash_File(const char *FileName, uint64_t &Hash)
+{
+	FILE *F = fopen(FileName, "rb");
+	if (!F) return false;
+	std::vector<uint8_t> Buf(1 << 16);
+	size_t Read;
+	Hash = Hash_Bytes(nullptr, 0);
+	while ((Read = fread(Buf.data(), 1, Buf.size(), F)) > 0)
+		Hash = Hash_Bytes(Buf.data(), Read, Hash);
+	fclose(F);
+	return true;
+}
+
+// Maps Path copy-on-write, so the page cache is shared between processes
+// while data patched after loading still gets private pages.
+char Map_File(const char *Path, FileMapping &M)
+{
+#ifdef _WIN32
+	M.File = CreateFileA(Path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (M.File == INVALID_HANDLE_VALUE) return 0;
+	LARGE_INTEGER Size;
+	GetFileSizeEx(M.File, &Size);
+	M.Size = (size_t)Size.QuadPart;
+	M.Map = M.Size ? CreateFileMappingA(M.File, NULL, PAGE_WRITECOPY, 0, 0, NULL) : NULL;
+	M.Base = M.Map ? MapViewOfFile(M.Map, FILE_MAP_COPY, 0, 0, 0) : NULL;
+	if (!M.Base)
+	{
+		if (M.Map) CloseHandle(M.Map);
+		CloseHandle(M.File);
+		return 0;
+	}
+	return 1;
+#else
+	int fd = open(Path, O_RDONLY);
+	if (fd < 0) return 0;
+	struct stat St;
+	if (fstat(fd, &St) || !St.st_size)
+	{
+		close(fd);
+		return 0;
+	}
+	M.Size = St.st_size;
+	M.Base = mmap(NULL, M.Size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+	return M.Base != MAP_FAILED;
+#endif
+}
+
+void Unmap_File(FileMapping &M)
+{
+#ifdef _WIN32
+	UnmapViewOfFile(M.Base);
+	CloseHandle(M.Map);
+	CloseHandle(M.File);
+#else
+	munmap(M.Base, M.Size);
+#endif
+}
@@ -1,5 +1,197 @@
 // Texture library maintainance, handles texture format unification, mipmapping, grouping
 // and ref-counting.
 
+#include <stdio.h>
+#include <string.h>
+#include <filesystem>
+#include <map>
+#include <mutex>
+
+#include "Base/FDS_DEFS.H"
+#include "Base/FDS_VARS.H"
 #include "Base/FDS_DECS.H"
 
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+#ifdef __EMSCRIPTEN__
+bool g_TextureCache = false; // MEMFS doesn't outlive the page
+#else
+bool g_TextureCache = true;
+#endif
+
+namespace txtrns {
+	constexpr dword TXCACHE_MAGIC = 0x58544446;	// 'FDTX'
+	constexpr dword TXCACHE_VERSION = 2;
+	// Mip data starts one page into the file, so the mapping keeps it page
+	// aligned (TheOtherBarry's gathers only need 64).
+	constexpr uintptr_t TXCACHE_DATA_OFFSET = 4096;
+
+	struct CacheHeader {
+		dword Magic, Version;
+		uint64_t SourceHash;			// Hash_Bytes of the whole source file
+		int32_t SizeX, SizeY, LSizeX, LSizeY;
+		int32_t blockSizeX, blockSizeY;
+		dword enableMip, numMipmaps;
+		dword MipFilter;				// g_MipFilter | g_MipLinear << 8
+		uint64_t DataSize;
+		uint64_t MipOffset[16];			// bytes from the start of the data
+	};
+
+	// Tx->Data of cache loaded textures => their file mapping.
+	std::map<uintptr_t, FileMapping> mappings;
+	std::mutex mappingLock;
+}
+
+static dword TextureCache_MipFilter()
+{
+	return g_MipFilter | (g_MipLinear ? 1 << 8 : 0);
+}
+
+// Block size and mip setting Unify_Textures will use for Tx.
+static void TextureCache_Params(const Texture *Tx, int32_t &BX, int32_t &BY, dword &Mip)
+{
+	BX = (Tx->Flags & Txtr_Tiled) ? DEFAULT_BLOCKSIZEX : 0;
+	BY = (Tx->Flags & Txtr_Tiled) ? DEFAULT_BLOCKSIZEY : 0;
+	Mip = !(Tx->Flags & Txtr_Nomip);
+}
+
+// Keyed by file name and processing parameters; the content hash in the
+// header decides whether the entry is still valid.
+static void Format_TXCachePath(char *Path, size_t Size, const Texture *Tx)
+{
+	int32_t BX, BY;
+	dword Mip;
+	TextureCache_Params(Tx, BX, BY, Mip);
+	snprintf(Path, Size, "Cache/TX_%016llX_%d%d%u.bin",
+		(unsigned long long)Hash_Bytes(Tx->FileName, strlen(Tx->FileName)), BX, BY, Mip);
+}
+
+// Fills Tx with its fully processed mip chain from Cache/ when an entry
+// for the same source bytes and processing parameters exists. Tx->Data and
+// Tx->Mipmap[] then point into the file mapping, and Generate_Mipmaps
+// leaves the texture alone. Returns 1 on a hit.
+char TextureCache_Load(Texture *Tx)
+{
+	using namespace txtrns;
+	if (!g_TextureCache || BPP != 32 || !Tx->FileName) return 0;
+
+	uint64_t Hash;
+	if (!Hash_File(Tx->FileName, Hash)) return 0;
+
+	char Path[64];
+	Format_TXCachePath(Path, sizeof(Path), Tx);
+	FileMapping M;
+	if (!Map_File(Path, M)) return 0;
+
+	int32_t BX, BY;
+	dword Mip;
+	TextureCache_Params(Tx, BX, BY, Mip);
+	const CacheHeader *H = (const CacheHeader *)M.Base;
+	if (M.Size < TXCACHE_DATA_OFFSET || H->Magic != TXCACHE_MAGIC || H->Version != TXCACHE_VERSION ||
+		H->SourceHash != Hash || H->blockSizeX != BX || H->blockSizeY != BY || H->enableMip != Mip ||
+		H->MipFilter != TextureCache_MipFilter() ||
+		!H->numMipmaps || H->numMipmaps > 16 || M.Size - TXCACHE_DATA_OFFSET < H->DataSize)
+	{
+		Unmap_File(M);
+		return 0;
+	}
+
+	byte *Data = (byte *)M.Base + TXCACHE_DATA_OFFSET;
+	Tx->BPP = 32;
+	Tx->SizeX = H->SizeX;
+	Tx->SizeY = H->SizeY;
+	Tx->LSizeX = H->LSizeX;
+	Tx->LSizeY = H->LSizeY;
+	Tx->blockSizeX = BX;
+	Tx->blockSizeY = BY;
+	Tx->numMipmaps = H->numMipmaps;
+	for (dword i = 0; i < H->numMipmaps; i++)
+		Tx->Mipmap[i] = Data + H->MipOffset[i];
+	Tx->Data = Data;
+	Tx->OptClass = 1;
+
+	std::lock_guard<std::mutex> Lock(mappingLock);
+	mappings[(uintptr_t)Data] = M;
+	return 1;
+}
+
+// Writes Tx's mip chain to Cache/ once Generate_Mipmaps has built it.
+// Textures that came from the cache, or have no chain, are skipped. The
+// entry is written under a temporary name and renamed into place, so
+// concurrent processes never map a partial file.
+void TextureCache_Store(Texture *Tx)
+{
+	using namespace txtrns;
+	if (!g_TextureCache || Tx->BPP != 32 || !Tx->numMipmaps || !Tx->FileName) return;
+	{
+		std::lock_guard<std::mutex> Lock(mappingLock);
+		if (mappings.count((uintptr_t)Tx->Data)) return;
+	}
+
+	CacheHeader H = {};
+	if (!Hash_File(Tx->FileName, H.SourceHash)) return;
+
+	int32_t BX, BY;
+	dword Mip;
+	TextureCache_Params(Tx, BX, BY, Mip);
+	if (Tx->blockSizeX != BX || Tx->blockSizeY != BY) return;
+
+	// same level sizes as Generate_Mipmaps
+	int32_t X = Tx->SizeX >> BX, Y = Tx->SizeY >> BY;
+	for (dword i = 0; i < Tx->numMipmaps; i++)
+	{
+		H.MipOffset[i] = Tx->Mipmap[i] - Tx->Data;
+		H.DataSize = H.MipOffset[i] + ((uint64_t)4 * X * Y << (BX + BY));
+		X = (X + 1) >> 1;
+		Y = (Y + 1) >> 1;
+	}
+	H.Magic = TXCACHE_MAGIC;
+	H.Version = TXCACHE_VERSION;
+	H.SizeX = Tx->SizeX;
+	H.SizeY = Tx->SizeY;
+	H.LSizeX = Tx->LSizeX;
+	H.LSizeY = Tx->LSizeY;
+	H.blockSizeX = BX;
+	H.blockSizeY = BY;
+	H.enableMip = Mip;
+	H.MipFilter = TextureCache_MipFilter();
+	H.numMipmaps = Tx->numMipmaps;
+
+	std::error_code ec;
+	std::filesystem::create_directories("Cache", ec);
+
+	char Path[64], TempPath[96];
+	Format_TXCachePath(Path, sizeof(Path), Tx);
+	snprintf(TempPath, sizeof(TempPath), "%s.%d_%p.tmp", Path, (int)getpid(), (void *)Tx);
+	FILE *F = fopen(TempPath, "wb");
+	if (!F) return;
+
+	static const byte Pad[TXCACHE_DATA_OFFSET] = {};
+	bool ok = fwrite(&H, sizeof(H), 1, F) == 1 &&
+		fwrite(Pad, TXCACHE_DATA_OFFSET - sizeof(H), 1, F) == 1 &&
+		fwrite(Tx->Data, H.DataSize, 1, F) == 1;
+	ok = !fclose(F) && ok;
+
+	if (ok)
+		std::filesystem::rename(TempPath, Path, ec);
+	if (!ok || ec)
+		std::filesystem::remove(TempPath, ec);
+}
+
+// Unmaps Data if it is a cache loaded texture's storage. Returns 0 (and
+// leaves Data alone) for ordinarily allocated textures.
+char TextureCache_Release(void *Data)
+{
+	using namespace txtrns;
+	std::lock_guard<std::mutex> Lock(mappingLock);
+	auto it = mappings.find((uintptr_t)Data);
+	if (it == mappings.end()) return 0;
+	Unmap_File(it->second);
+	mappings.erase(it);
+	return 1;
+}
@@ -1,12 +1,119 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
-#include <queue>
+#include <memory>
+#include <new>
 #include <thread>
+#include <type_traits>
+#include <utility>
 #include <vector>
-#include <mutex>
 
+// Work-stealing job system.
+//
+// Every thread that submits or runs jobs owns a fixed-size Chase-Lev deque
+// and a ring of Job slots. The owner pushes/pops at the bottom of its deque
+// without locking; idle threads steal from the top of other deques. Jobs
+// store their callable inline, so submitting never allocates. A ring slot
+// stays reserved from submission until its callable has been moved out by
+// whichever thread runs it; if the next slot is still reserved (or the deque
+// is full) the submitter runs the job inline instead of overwriting it.
+//
+// A JobGroup counts outstanding jobs. ThreadPool::wait(group) doesn't block
+// the caller: it keeps popping/stealing jobs until the group drains, so the
+// director thread contributes to the frame instead of sleeping on a condvar.
+
+class ThreadPool;
+
+class JobGroup {
+public:
+	JobGroup() = default;
+	JobGroup(const JobGroup&) = delete;
+	JobGroup& operator=(const JobGroup&) = delete;
+
+	bool done() const { return pending.load(std::memory_order_acquire) == 0; }
+
+private:
+	friend class ThreadPool;
+	std::atomic<int32_t> pending = 0;
+};
+
+struct alignas(64) Job {
+	static constexpr size_t StorageSize = 128 - 32;
+
+	void (*invoke)(Job*);
+	JobGroup* group;
+	std::atomic<uint32_t> busy = 0;
+	alignas(16) unsigned char storage[StorageSize];
+};
+
+// Fixed capacity Chase-Lev deque (Le, Pop, Cohen, Nardelli 2013).
+// push/pop: owner thread only. steal: any thread.
+class JobDeque {
+public:
+	static constexpr int64_t Capacity = 2048;
+	static constexpr int64_t Mask = Capacity - 1;
+
+	// Owner thread only. Stealers only shrink the deque, so a false result
+	// guarantees the next push succeeds.
+	bool full() const {
+		return bottom.load(std::memory_order_relaxed) - top.load(std::memory_order_acquire) >= Capacity;
+	}
+
+	bool push(Job* job) {
+		int64_t b = bottom.load(std::memory_order_relaxed);
+		int64_t t = top.load(std::memory_order_acquire);
+		if (b - t >= Capacity) return false;
+		jobs[b & Mask].store(job, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		bottom.store(b + 1, std::memory_order_relaxed);
+		return true;
+	}
+
+	Job* pop() {
+		int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+		bottom.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t t = top.load(std::memory_order_relaxed);
+
+		if (t > b) {
+			bottom.store(b + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		Job* job = jobs[b & Mask].load(std::memory_order_relaxed);
+		if (t == b) {
+			// last entry, race against stealers
+			if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+				job = nullptr;
+			}
+			bottom.store(b + 1, std::memory_order_relaxed);
+		}
+		return job;
+	}
+
+	Job* steal() {
+		int64_t t = top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t b = bottom.load(std::memory_order_acquire);
+		if (t >= b) return nullptr;
+
+		Job* job = jobs[t & Mask].load(std::memory_order_relaxed);
+		if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+			return nullptr;
+		}
+		return job;
+	}
+
+private:
+	alignas(64) std::atomic<int64_t> top = 0;
+	alignas(64) std::atomic<int64_t> bottom = 0;
+	std::atomic<Job*> jobs[Capacity];
+};
 
 class ThreadPool {
 public:
@@ -15,52 +122,231 @@ public:
 		return inst;
 	}
 
-	using item_t = std::function<void()>;
+	using init_t = std::function<void()>;
 
-	void init(item_t initFunc) {
-		auto numThreads = std::thread::hardware_concurrency();
-		for (size_t ii = 0; ii < numThreads; ii++) {
-			pool.push_back(std::thread([this, initFunc]() {initFunc(); worker(); }));
-		}
-	}
+	// Worker threads plus this many non-pool threads (director, loader
+	// threads) may submit and wait on jobs.
+	static constexpr size_t MaxExternalThreads = 8;
 
-	void enqueue(item_t f) {
-		{
-			std::unique_lock lock(qm);
-			q.push(f);
+	void init(init_t initFunc) {
+		auto hw = std::thread::hardware_concurrency();
+		// The thread calling wait() runs jobs too, so leave it a core.
+		numWorkers = hw > 1 ? hw - 1 : 1;
+		numQueues = numWorkers + MaxExternalThreads;
+		queues = std::make_unique<ThreadQueue[]>(numQueues);
+		nextExternal = numWorkers;
+
+		for (size_t ii = 0; ii < numWorkers; ii++) {
+			pool.push_back(std::thread([this, initFunc, ii]() {
+				t_queue = ii;
+				t_pool = this;
+				initFunc();
+				worker();
+			}));
 		}
-		condition.notify_one();
 	}
 
 	void close() {
 		terminate = true;
-		condition.notify_all();
+		wake(true);
 		for (auto& t : pool) {
 			t.join();
 		}
+		pool.clear();
+	}
+
+	// Number of threads that execute jobs during wait(): workers + caller.
+	size_t concurrency() const {
+		return numWorkers + 1;
+	}
+
+	// Submit f() as part of group. f must fit in Job::StorageSize.
+	template <typename F>
+	void run(JobGroup& group, F&& f) {
+		using Fn = std::decay_t<F>;
+		static_assert(sizeof(Fn) <= Job::StorageSize, "job callable too large for inline storage");
+		static_assert(alignof(Fn) <= 16, "job callable over-aligned");
+
+		group.pending.fetch_add(1, std::memory_order_relaxed);
+
+		ThreadQueue* q = localQueue();
+		if (!q) {
+			// Out of queue slots: degrade to inline execution.
+			f();
+			group.pending.fetch_sub(1, std::memory_order_release);
+			return;
+		}
+
+		// Claim the slot only if nobody still owns it: a queued job, or one a
+		// thief has taken off the deque but not yet started.
+		Job* job = &q->ring[q->allocated & (RingSize - 1)];
+		if (q->deque.full() || job->busy.load(std::memory_order_acquire)) {
+			f();
+			group.pending.fetch_sub(1, std::memory_order_release);
+			return;
+		}
+		q->allocated++;
+		job->busy.store(1, std::memory_order_relaxed);
+
+		new (job->storage) Fn(std::forward<F>(f));
+		job->group = &group;
+		job->invoke = [](Job* j) {
+			// Move the callable out first, so the ring slot is free as soon
+			// as the job starts running.
+			Fn* stored = std::launder(reinterpret_cast<Fn*>(j->storage));
+			Fn fn(std::move(*stored));
+			stored->~Fn();
+			j->busy.store(0, std::memory_order_release);
+			fn();
+		};
+
+		bool pushed = q->deque.push(job);
+		assert(pushed);
+		(void)pushed;
+		wake(false);
+	}
+
+	// Run jobs until every job in group has completed.
+	void wait(JobGroup& group) {
+		ThreadQueue* q = localQueue();
+		uint32_t spins = 0;
+		while (!group.done()) {
+			if (Job* job = findJob(q)) {
+				execute(job);
+				spins = 0;
+			} else if (++spins > 64) {
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	// Calls f(begin, end) over [0, count) in chunks of at most grain items,
+	// spread across the pool; returns when all chunks are done. Chunks are
+	// handed out through a shared counter so uneven chunk costs balance out.
+	template <typename F>
+	void parallel_for(size_t count, size_t grain, F&& f) {
+		if (count == 0) return;
+		grain = std::max<size_t>(grain, 1);
+		const size_t numChunks = (count + grain - 1) / grain;
+		if (numChunks == 1 || numWorkers == 0) {
+			f(size_t(0), count);
+			return;
+		}
+
+		std::atomic<size_t> next = 0;
+		auto body = [&next, &f, count, grain]() {
+			for (;;) {
+				size_t begin = next.fetch_add(grain, std::memory_order_relaxed);
+				if (begin >= count) break;
+				f(begin, std::min(begin + grain, count));
+			}
+		};
+
+		JobGroup group;
+		const size_t helpers = std::min(numChunks, concurrency()) - 1;
+		for (size_t i = 0; i < helpers; ++i) {
+			run(group, body);
+		}
+		body();
+		wait(group);
 	}
 
 private:
+	static constexpr size_t RingSize = JobDeque::Capacity;
+	static_assert((RingSize & (RingSize - 1)) == 0, "ring size must be a power of two");
+
+	struct ThreadQueue {
+		JobDeque deque;
+		uint32_t allocated = 0;
+		Job ring[RingSize];
+	};
+
+	static inline thread_local size_t t_queue = size_t(-1);
+	static inline thread_local ThreadPool* t_pool = nullptr;
+	static inline thread_local uint32_t t_rand = 0x9E3779B9u;
+
+	ThreadQueue* localQueue() {
+		if (t_pool != this) {
+			size_t index = nextExternal.fetch_add(1, std::memory_order_relaxed);
+			if (index >= numQueues) return nullptr;
+			t_pool = this;
+			t_queue = index;
+			t_rand ^= uint32_t(index * 0x85EBCA6Bu);
+		}
+		return &queues[t_queue];
+	}
+
+	Job* findJob(ThreadQueue* q) {
+		if (q) {
+			if (Job* job = q->deque.pop()) return job;
+		}
+
+		// xorshift32 victim selection
+		t_rand ^= t_rand << 13;
+		t_rand ^= t_rand >> 17;
+		t_rand ^= t_rand << 5;
+		const size_t n = std::min<size_t>(numQueues, nextExternal.load(std::memory_order_relaxed));
+		const size_t start = t_rand % n;
+		for (size_t i = 0; i < n; ++i) {
+			ThreadQueue* victim = &queues[(start + i) % n];
+			if (victim == q) continue;
+			if (Job* job = victim->deque.steal()) return job;
+		}
+		return nullptr;
+	}
+
+	// The slot may be reused once invoke has moved the callable out, so
+	// read everything needed afterwards first.
+	void execute(Job* job) {
+		JobGroup* group = job->group;
+		job->invoke(job);
+		group->pending.fetch_sub(1, std::memory_order_release);
+	}
+
+	void wake(bool all) {
+		epoch.fetch_add(1, std::memory_order_seq_cst);
+		if (all || sleepers.load(std::memory_order_seq_cst)) {
+			epoch.notify_all();
+		}
+	}
+
 	void worker() {
+		ThreadQueue* q = &queues[t_queue];
+		uint32_t spins = 0;
 		while (!terminate) {
-			std::function<void()> item;
-			{
-				std::unique_lock<std::mutex> lock(qm);
-				condition.wait(lock, [this] {return !q.empty() || terminate; });
-				if (terminate) {
-					break;
-				}
-				item = std::move(q.front());
-				q.pop();
+			if (Job* job = findJob(q)) {
+				execute(job);
+				spins = 0;
+				continue;
+			}
+			if (++spins < 256) {
+				std::this_thread::yield();
+				continue;
 			}
-			item();
+
+			// Nothing to do: sleep until the next submission.
+			uint32_t e = epoch.load(std::memory_order_seq_cst);
+			sleepers.fetch_add(1, std::memory_order_seq_cst);
+			if (Job* job = findJob(q)) {
+				sleepers.fetch_sub(1, std::memory_order_relaxed);
+				execute(job);
+				spins = 0;
+				continue;
+			}
+			if (!terminate) {
+				epoch.wait(e, std::memory_order_seq_cst);
+			}
+			sleepers.fetch_sub(1, std::memory_order_relaxed);
+			spins = 0;
 		}
 	}
 
-	std::mutex qm;
-	std::condition_variable condition;
-	std::queue<item_t> q;
+	size_t numWorkers = 0;
+	size_t numQueues = 0;
+	std::unique_ptr<ThreadQueue[]> queues;
+	std::atomic<size_t> nextExternal = 0;
+	std::atomic<uint32_t> epoch = 0;
+	std::atomic<uint32_t> sleepers = 0;
 	std::atomic<bool> terminate = false;
 	std::vector<std::thread> pool;
 };
-
@@ -5,6 +5,7 @@
 //#include <intrin.h>
 #include "simde/x86/avx2.h"
 #include <simd/vectorclass.h>
+#include <Threads.h>
 
 
 #define LFB_LIMIT 0x003FFFFF
@@ -155,219 +156,133 @@ struct alignas(16) uint128 {
 #pragma pack(pop)
 
 
-// 32bit MMX Alpha blending, 
-inline void AlphaBlend(byte *Source,byte *Target,DWord &PerSource,DWord &PerTarget, dword page_size)
+// Page blend kernels (motion blur, cross fades).
+//
+// Every kernel works on a byte range [begin,end) of the page, 32 bytes per
+// step through the AVX2 intrinsics, which simde lowers to SSE2 or wasm SIMD
+// where AVX2 isn't available. Blend_Bands cuts the page into bands of
+// BLEND_BAND_BYTES and spreads them over the thread pool; the tail of a page
+// that isn't a multiple of 32 bytes is blended per byte.
+#define BLEND_BAND_BYTES (64*1024)
+
+template <typename F>
+inline void Blend_Bands(dword page_size, F &&Kernel)
 {
-	Vec16uc perSrc = Vec16uc(Vec4ui(PerSource));
-	Vec16uc perDst = Vec16uc(Vec4ui(PerTarget));
-
-	auto psrc = _mm_srli_epi16(_mm_unpacklo_epi8(perSrc, perSrc), 8);
-	auto pdst = _mm_srli_epi16(_mm_unpacklo_epi8(perDst, perDst), 8);
-
-	//uint128 perSrc;
-	//perSrc.low = perSrc.high = PerSource | static_cast<uint64>(PerSource) << 32;
-	//uint128 perDst;
-	//perDst.low = perDst.high = PerTarget | static_cast<uint64>(PerTarget) << 32;
-
-	//uint128 *perSrcRef = &perSrc;
-	//uint128 *perDstRef = &perDst;
-
-	Vec16uc src, dst;
-	for (int ii = 0; ii < page_size; ii += 32) {
-		src.load_a(Source + ii);
-		dst.load_a(Target + ii);
-
-		auto srcl_ = _mm_unpacklo_epi8(src, src);
-		auto srch_ = _mm_unpackhi_epi8(src, src);
-		auto dstl_ = _mm_unpacklo_epi8(dst, dst);
-		auto dsth_ = _mm_unpackhi_epi8(dst, dst);
-
-		auto msl = _mm_mulhi_epu16(srcl_, psrc);
-		auto msh = _mm_mulhi_epu16(srch_, psrc);
-		auto mdl = _mm_mulhi_epu16(dstl_, pdst);
-		auto mdh = _mm_mulhi_epu16(dsth_, pdst);
-
-		auto l = _mm_adds_epu8(msl, mdl);
-		auto h = _mm_adds_epu8(msh, mdh);
-
-		auto result = Vec16uc(_mm_packus_epi16(l, h));
-
-		result.store_a(Target + ii);
-
-		src.load_a(Source + ii + 16);
-		dst.load_a(Target + ii + 16);
-
-		srcl_ = _mm_unpacklo_epi8(src, src);
-		srch_ = _mm_unpackhi_epi8(src, src);
-		dstl_ = _mm_unpacklo_epi8(dst, dst);
-		dsth_ = _mm_unpackhi_epi8(dst, dst);
-
-		msl = _mm_mulhi_epu16(srcl_, psrc);
-		msh = _mm_mulhi_epu16(srch_, psrc);
-		mdl = _mm_mulhi_epu16(dstl_, pdst);
-		mdh = _mm_mulhi_epu16(dsth_, pdst);
+	ThreadPool::instance().parallel_for(page_size, BLEND_BAND_BYTES, [&](size_t begin, size_t end) {
+		Kernel(begin, end);
+	});
+}
 
-		l = _mm_adds_epu8(msl, mdl);
-		h = _mm_adds_epu8(msh, mdh);
+// Per-channel blend factors as 16 bit words, two pixels per 128 bit lane.
+inline __m256i AlphaBlend_Factors(DWord Per)
+{
+	__m256i p = _mm256_set1_epi32(Per);
+	return _mm256_srli_epi16(_mm256_unpacklo_epi8(p, p), 8);
+}
 
-		result = Vec16uc(_mm_packus_epi16(l, h));
+// Target = Source*PerSource + Target*PerTarget per channel, saturated;
+// factors are 0..255 fixed point. Out (optional) receives a copy of the
+// result, which lets a flip write the presented frame in the same pass.
+inline void AlphaBlend_Span(const byte *Source, byte *Target, byte *Out, DWord PerSource, DWord PerTarget, size_t begin, size_t end)
+{
+	const __m256i psrc = AlphaBlend_Factors(PerSource);
+	const __m256i pdst = AlphaBlend_Factors(PerTarget);
+
+	size_t ii = begin;
+	for (; ii + 32 <= end; ii += 32) {
+		__m256i src = _mm256_loadu_si256((const __m256i *)(Source + ii));
+		__m256i dst = _mm256_loadu_si256((const __m256i *)(Target + ii));
+
+		__m256i l = _mm256_adds_epu8(
+			_mm256_mulhi_epu16(_mm256_unpacklo_epi8(src, src), psrc),
+			_mm256_mulhi_epu16(_mm256_unpacklo_epi8(dst, dst), pdst));
+		__m256i h = _mm256_adds_epu8(
+			_mm256_mulhi_epu16(_mm256_unpackhi_epi8(src, src), psrc),
+			_mm256_mulhi_epu16(_mm256_unpackhi_epi8(dst, dst), pdst));
+
+		__m256i result = _mm256_packus_epi16(l, h);
+		_mm256_storeu_si256((__m256i *)(Target + ii), result);
+		if (Out) _mm256_storeu_si256((__m256i *)(Out + ii), result);
+	}
 
-		result.store_a(Target + ii + 16);
+	// same fixed point as pmulhuw: (x*257*p)>>16
+	for (; ii < end; ii++) {
+		dword ps = (PerSource >> ((ii & 3) << 3)) & 0xFF;
+		dword pt = (PerTarget >> ((ii & 3) << 3)) & 0xFF;
+		dword r = ((Source[ii] * 257 * ps) >> 16) + ((Target[ii] * 257 * pt) >> 16);
+		Target[ii] = r > 255 ? 255 : r;
+		if (Out) Out[ii] = Target[ii];
 	}
-//
-//	dword ps = page_size;
-//
-//	__asm
-//	{
-//#ifdef __clang__
-//		pushad
-//		mov ebx, perSrcRef
-//		mov ecx, perDstRef
-//		mov edi, Target
-//		mov esi, Source
-//#else
-//		pushad
-//		mov edi, Target
-//		mov esi, Source
-//		mov eax, perSrcRef
-//		mov edx, perDstRef
-//		mov ebx, eax
-//		mov ecx, edx
-//#endif
-//		punpcklbw xmm7, [ebx]
-//		punpcklbw xmm6, [ecx]
-//		psrlw xmm7, 8
-//		psrlw xmm6, 8
-//		mov ecx, ps
-//		add esi, ecx
-//		add edi, ecx
-//		neg ECX
-//#ifndef __clang__
-//		Align 16
-//#endif
-//		AlphaBlendLoop :
-//		punpcklbw xmm1, [esi + ecx]
-//		punpcklbw xmm0, [edi + ecx]
-//		pmulhuw xmm1, xmm7
-//		punpckhbw xmm3, [esi + ecx]
-//		pmulhuw xmm0, xmm6
-//		pmulhuw xmm3, xmm7
-//		punpckhbw xmm2, [edi + ecx]
-//		paddusb  xmm1, xmm0
-//		pmulhuw xmm2, xmm6
-//
-//		paddusb  xmm3, xmm2
-//		packuswb xmm1, xmm3
-//		movdqa [edi + ecx], xmm1
-//
-//		punpcklbw xmm1, [esi + ecx + 16]
-//		punpcklbw xmm0, [edi + ecx + 16]
-//		pmulhuw xmm1, xmm7
-//		punpckhbw xmm3, [esi + ecx + 16]
-//		pmulhuw xmm0, xmm6
-//		pmulhuw xmm3, xmm7
-//		punpckhbw xmm2, [edi + ecx + 16]
-//		paddusb  xmm1, xmm0
-//		pmulhuw xmm2, xmm6
-//
-//		paddusb  xmm3, xmm2
-//		packuswb xmm1, xmm3
-//		movdqa[edi + ecx + 16], xmm1
-//
-//
-//		add ecx, 32
-//		jnz AlphaBlendLoop
-//		popad
-//
-//	}
+}
 
+// 32bit Alpha blending over the whole page.
+inline void AlphaBlend(byte *Source,byte *Target,DWord &PerSource,DWord &PerTarget, dword page_size)
+{
+	DWord ps = PerSource, pt = PerTarget;
+	Blend_Bands(page_size, [=](size_t begin, size_t end) {
+		AlphaBlend_Span(Source, Target, nullptr, ps, pt, begin, end);
+	});
+}
 
-//	__asm
-//	{
-//		mov esi, Source
-//		mov edi, Target
-//		mov ebx, PerSource
-//		mov ecx, PerTarget
-//
-//		punpcklbw mm7,[ebx]
-//		punpcklbw mm6,[ecx]
-//		psrlw mm7,8
-//		psrlw mm6,8
-//		mov ecx,[PageSize]
-//		add esi,ecx
-//		add edi,ecx
-//		neg ECX
-//AlphaBlendLoop:
-//			punpcklbw mm1,[esi+ecx]
-//			punpcklbw mm0,[edi+ecx]
-//			punpcklbw mm3,[esi+ecx+4]
-//			punpcklbw mm2,[edi+ecx+4]
-//
-//;			This should be more efficient
-//;			USING OPCODES! stupid assember.
-//			pmulhuw mm1,mm7
-//			pmulhuw mm0,mm6
-//			pmulhuw mm3,mm7
-//			pmulhuw mm2,mm6
-//;			Original code
-//;			psrlw mm1,8
-//;			psrlw mm0,8
-//;			pmullw mm1,mm7
-//;			pmullw mm0,mm6
-//;			psrlw mm1,8
-//;			psrlw mm0,8
-//;			psrlw mm1,8
-//;			psrlw mm0,8
-//;			pmullw mm3,mm7
-//;			pmullw mm2,mm6
-//;			psrlw mm1,8
-//;			psrlw mm0,8
-//
-//;			optimized double pixel writeback
-//			paddusb  mm1,mm0
-//			paddusb  mm3,mm2
-//			packuswb mm1,mm3
-//;			movq [edi+ecx],mm1
-//			movq [edi+ecx],mm1
-//			add ecx,8
-//		jnz AlphaBlendLoop
-//		emms
-//	}
- //   byte *mulsrc = reinterpret_cast<byte*>(&PerSource);
- //   byte *muldst = reinterpret_cast<byte*>(&PerTarget);
-	//for(int j=0; j<YRes; ++j)
-	//{	
-	//	for(int i=0, n=XRes; i<n; ++i)
-	//	{
- //           byte *src = reinterpret_cast<byte *>(&Source[i*4]);
- //           byte *dst = reinterpret_cast<byte *>(&Target[i*4]);
- //           for (int channel=0; channel < 4; ++channel) {
- //               int res = (src[channel] * mulsrc[channel] +  dst[channel]*muldst[channel]) >> 8;
-	//			if (res > 255) res = 255;
-	//			dst[channel] = res;
- //           }
-	//	}
-	//	Source += MainSurf->BPSL;
-	//	Target += MainSurf->BPSL;
-	//}
+// Row-wise AlphaBlend that also writes the result to Out, whose pitch may
+// differ from the surfaces'. Used by fused blend+flip implementations.
+inline void AlphaBlend_Rows(const byte *Source, byte *Target, dword BPSL, byte *Out, dword OutPitch, dword Rows, DWord PerSource, DWord PerTarget)
+{
+	const size_t rowsPerBand = std::max<size_t>(1, BLEND_BAND_BYTES / BPSL);
+	ThreadPool::instance().parallel_for(Rows, rowsPerBand, [&](size_t begin, size_t end) {
+		for (size_t y = begin; y < end; y++) {
+			AlphaBlend_Span(Source + y * BPSL, Target + y * BPSL, Out + y * OutPitch, PerSource, PerTarget, 0, BPSL);
+		}
+	});
 }
 
-//inline void AlphaBlend(byte* Source, byte* Target, DWord& PerSource, DWord& PerTarget, DWord Size) {
-//	//auto tmp = PageSize;
-//	//PageSize = Size;
-//	AlphaBlend(Source, Target, PerSource, PerTarget, Size);
-//	//PageSize = tmp;
-//}
+// 50/50 blend of Source into Target (the non-MMX motion blur).
+// 565 channels are averaged with the usual carry-free trick:
+// (a&b) + ((a^b)&~lsb)>>1.
+inline void Transparence_16_Span(const byte *Source, byte *Target, size_t begin, size_t end)
+{
+	const __m256i mask = _mm256_set1_epi16(short(0xF7DE));
+
+	size_t ii = begin;
+	for (; ii + 32 <= end; ii += 32) {
+		__m256i a = _mm256_loadu_si256((const __m256i *)(Source + ii));
+		__m256i b = _mm256_loadu_si256((const __m256i *)(Target + ii));
+		__m256i avg = _mm256_add_epi16(_mm256_and_si256(a, b),
+			_mm256_srli_epi16(_mm256_and_si256(_mm256_xor_si256(a, b), mask), 1));
+		_mm256_storeu_si256((__m256i *)(Target + ii), avg);
+	}
+	for (; ii + 2 <= end; ii += 2) {
+		word a = *(const word *)(Source + ii), b = *(word *)(Target + ii);
+		*(word *)(Target + ii) = (a & b) + (((a ^ b) & 0xF7DE) >> 1);
+	}
+}
 
+inline void Transparence_32_Span(const byte *Source, byte *Target, size_t begin, size_t end)
+{
+	size_t ii = begin;
+	for (; ii + 32 <= end; ii += 32) {
+		__m256i a = _mm256_loadu_si256((const __m256i *)(Source + ii));
+		__m256i b = _mm256_loadu_si256((const __m256i *)(Target + ii));
+		_mm256_storeu_si256((__m256i *)(Target + ii), _mm256_avg_epu8(a, b));
+	}
+	for (; ii < end; ii++) {
+		Target[ii] = (Source[ii] + Target[ii] + 1) >> 1;
+	}
+}
 
 inline void Transparence_16(byte *Source, byte *Target)
 {
-	// x86 asm motion-blur kernel deleted; no portable replacement yet.
+	// keep bands on pixel boundaries
+	Blend_Bands(PageSize >> 1, [=](size_t begin, size_t end) {
+		Transparence_16_Span(Source, Target, begin << 1, end << 1);
+	});
 }
 
 inline void Transparence_32(byte *Source, byte *Target)
 {
-	// x86 asm motion-blur kernel deleted; no portable replacement yet.
+	Blend_Bands(PageSize, [=](size_t begin, size_t end) {
+		Transparence_32_Span(Source, Target, begin, end);
+	});
 }
 
 inline void Modulate(VESA_Surface *Source,VESA_Surface *Target,DWord SrcMask,DWord TrgMask, dword PageSize)
@@ -0,0 +1,31 @@
+// FLDC - compiles Flood scenes into the .FLC images LoadFLD prefers.
+//
+//   FLDC SCENES/CITY.FLD [SCENES/GREETS.FLD ...]
+//
+// Each image is written next to its scene. Run it from the directory the
+// demo runs in (Runtime/), since materials name their textures relative
+// to it.
+
+#include <stdio.h>
+
+#include "Base/FDS_DEFS.H"
+#include "Base/FDS_VARS.H"
+#include "Base/FDS_DECS.H"
+
+int main(int argc, char **argv)
+{
+	if (argc < 2)
+	{
+		printf("Usage: FLDC scene.FLD [scene.FLD ...]\n");
+		return 1;
+	}
+
+	int Failed = 0;
+	for (int i = 1; i < argc; i++)
+		if (!CompileFLD(argv[i], NULL))
+		{
+			printf("Error! Unable to compile \"%s\"!\n", argv[i]);
+			Failed++;
+		}
+	return Failed ? 1 : 0;
+}